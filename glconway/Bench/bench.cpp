@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "conway.h"
+#include "hashlife.h"
+
+/*
+    Hashlife thread scaling benchmark
+
+    usage: bench [tiles] [log2 generations] [max threads]
+
+    builds a metacell-style board: a square grid of 64 x 64 tiles, each either
+    empty or holding a glider gun feeding an eater, at a random phase
+*/
+
+#define TILE 64
+#define PERIOD 30
+
+// GLIDER GUN
+const char* gun[9] = {
+    "                        1           ",
+    "                      1 1           ",
+    "            11      11            11",
+    "           1   1    11            11",
+    "11        1     1   11              ",
+    "11        1   1 11    1 1           ",
+    "          1     1       1           ",
+    "           1   1                    ",
+    "            11                      " };
+
+// EATER
+const char* eater[4] = {
+    "11  ",
+    "1 1 ",
+    "  1 ",
+    "  11" };
+
+double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// every phase of one gun + eater tile, NULL if the tile does not cycle with the gun's period
+char **buildPhases()
+{
+    conway tile;
+    conway_init(&tile, 0, TILE, TILE);
+
+    for (int x = 0; x < 9; x++)
+    {
+        for (int y = 0; y < 36; y++)
+        {
+            tile.board[(x + 8) * TILE + y + 8] = gun[x][y] != ' ';
+        }
+    }
+    for (int x = 0; x < 4; x++)
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            // on the glider stream, 28 rows and 42 columns past the gun's corner
+            tile.board[(x + 36) * TILE + y + 50] = eater[x][y] != ' ';
+        }
+    }
+
+    // let the first gliders settle into the eater
+    conway_simulateN(&tile, 10 * PERIOD);
+
+    char **phases = (char**)malloc(PERIOD * sizeof(char*));
+    for (int i = 0; i < PERIOD; i++)
+    {
+        phases[i] = (char*)malloc(TILE * TILE);
+        memcpy(phases[i], tile.board, TILE * TILE);
+        conway_simulate(&tile);
+    }
+
+    // a live gun comes back after a period and differs half way through, debris would not
+    bool cycles = !memcmp(tile.board, phases[0], TILE * TILE) && memcmp(phases[0], phases[PERIOD / 2], TILE * TILE);
+    conway_destroy(&tile);
+    if (!cycles)
+    {
+        for (int i = 0; i < PERIOD; i++)
+        {
+            free(phases[i]);
+        }
+        free(phases);
+        return NULL;
+    }
+
+    return phases;
+}
+
+void buildBoard(conway *c, int tiles, char **phases)
+{
+    conway_init(c, 0, tiles * TILE, tiles * TILE);
+
+    srand(29);
+    for (int tx = 0; tx < tiles; tx++)
+    {
+        for (int ty = 0; ty < tiles; ty++)
+        {
+            // roughly half the tiles are on
+            if (rand() % 2)
+            {
+                continue;
+            }
+
+            char *phase = phases[rand() % PERIOD];
+            for (int x = 0; x < TILE; x++)
+            {
+                memcpy(c->board + (tx * TILE + x) * c->y + ty * TILE, phase + x * TILE, TILE);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int tiles = argc > 1 ? atoi(argv[1]) : 64;
+    int log2Gens = argc > 2 ? atoi(argv[2]) : 12;
+    int maxThreads = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    if (maxThreads <= 0)
+    {
+        maxThreads = 1;
+    }
+
+    char **phases = buildPhases();
+    if (!phases)
+    {
+        printf("gun + eater tile does not cycle with period %d\n", PERIOD);
+        return 1;
+    }
+
+    conway c;
+    buildBoard(&c, tiles, phases);
+
+    printf("board %d x %d, %d tiles, 2^%d generations\n", c.x, c.y, tiles * tiles, log2Gens);
+    printf("threads  import (ms)  simulate (ms)  speedup  population  nodes\n");
+
+    double baseline = 0.0;
+    long long expected = -1;
+    for (int threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2)
+    {
+        hashlife h;
+        hashlife_init(&h, threads, 22);
+
+        auto start = std::chrono::steady_clock::now();
+        hashlife_import(&h, &c);
+        double importTime = elapsed(start);
+
+        start = std::chrono::steady_clock::now();
+        hashlife_simulateN(&h, 1LL << log2Gens);
+        double simulateTime = elapsed(start);
+
+        if (threads == 1)
+        {
+            baseline = simulateTime;
+            expected = hashlife_population(&h);
+        }
+
+        printf("%7d  %11.1f  %13.1f  %7.2f  %10lld  %lld%s\n",
+            threads, importTime, simulateTime, baseline / simulateTime,
+            hashlife_population(&h), hashlife_nodeCount(&h),
+            hashlife_population(&h) == expected ? "" : "  MISMATCH");
+
+        hashlife_destroy(&h);
+
+        if (threads == maxThreads)
+        {
+            break;
+        }
+    }
+
+    conway_destroy(&c);
+    for (int i = 0; i < PERIOD; i++)
+    {
+        free(phases[i]);
+    }
+    free(phases);
+
+    return 0;
+}
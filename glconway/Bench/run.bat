@@ -0,0 +1,2 @@
+g++ -O2 -std=c++20 -I../Game -o bench.exe bench.cpp ../Game/conway.cpp ../Game/threadPool.cpp ../Game/hashlife.cpp
+bench.exe
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "checkpoint.h"
+#include "compress.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CHECKPOINT_MAGIC "CONWAYCK"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_CHUNK (64LL << 20) // cells per chunk
+
+// 64 bit file offsets
+#ifdef _WIN32
+#define checkpoint_seek _fseeki64
+#else
+#define checkpoint_seek fseeko
+#endif
+
+/*
+    file layout
+    - header
+    - compressed size of each chunk
+    - chunks, in order
+*/
+typedef struct
+{
+    char magic[8];
+    int64_t version;
+    int64_t x;
+    int64_t y;
+    int64_t wrap;
+    int64_t birth;
+    int64_t survive;
+    int64_t generation;
+    int64_t chunkCells;
+    int64_t chunkCount;
+} checkpointHeader;
+
+struct checkpointJob
+{
+    std::thread thread;
+    int ret;
+};
+
+// run fn(i) for i in [0, n) on every core
+static void checkpoint_parallel(long long n, const std::function<void(long long)> &fn)
+{
+    std::atomic<long long> next(0);
+    auto worker = [&]() {
+        for (long long i; (i = next++) < n; )
+        {
+            fn(i);
+        }
+    };
+
+    unsigned int nThreads = std::thread::hardware_concurrency();
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < nThreads && t < n; t++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+}
+
+// compress the packed board chunk by chunk, writing chunks in order as they finish
+static int checkpoint_write(checkpointHeader header, unsigned char *packed, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    std::vector<int64_t> sizes(header.chunkCount, 0);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(sizes.data(), sizeof(int64_t), sizes.size(), file);
+
+    long long cells = header.x * header.y;
+    std::mutex lock;
+    std::condition_variable turn;
+    long long nextToWrite = 0;
+    bool failed = false;
+
+    checkpoint_parallel(header.chunkCount, [&](long long i) {
+        long long begin = i * header.chunkCells;
+        long long count = begin + header.chunkCells < cells ? header.chunkCells : cells - begin;
+        size_t packedSize = (size_t)(count + 7) / 8;
+
+        unsigned char *out = (unsigned char*)malloc(compress_rleBound(packedSize));
+        size_t size = compress_rle(packed + begin / 8, packedSize, out);
+
+        // wait for the chunks before this one
+        std::unique_lock<std::mutex> guard(lock);
+        turn.wait(guard, [&] { return nextToWrite == i; });
+        if (fwrite(out, 1, size, file) != size)
+        {
+            failed = true;
+        }
+        sizes[i] = (int64_t)size;
+        nextToWrite++;
+        turn.notify_all();
+        guard.unlock();
+
+        free(out);
+    });
+
+    // fill in the chunk sizes
+    checkpoint_seek(file, sizeof(header), SEEK_SET);
+    fwrite(sizes.data(), sizeof(int64_t), sizes.size(), file);
+
+    return fclose(file) || failed ? -1 : 0;
+}
+
+checkpointJob *checkpoint_saveAsync(conway *c, const char *path)
+{
+    checkpointHeader header;
+    memcpy(header.magic, CHECKPOINT_MAGIC, 8);
+    header.version = CHECKPOINT_VERSION;
+    header.x = c->x;
+    header.y = c->y;
+    header.wrap = c->wrap;
+    header.birth = c->birth;
+    header.survive = c->survive;
+    header.generation = c->generation;
+    header.chunkCells = CHECKPOINT_CHUNK;
+
+    long long cells = header.x * header.y;
+    header.chunkCount = (cells + CHECKPOINT_CHUNK - 1) / CHECKPOINT_CHUNK;
+
+    // bit packed snapshot, an eighth of the board
+    unsigned char *packed = (unsigned char*)malloc((size_t)(cells + 7) / 8);
+    checkpoint_parallel(header.chunkCount, [&](long long i) {
+        long long begin = i * CHECKPOINT_CHUNK;
+        long long count = begin + CHECKPOINT_CHUNK < cells ? CHECKPOINT_CHUNK : cells - begin;
+        compress_packBits(c->board + begin, (size_t)count, packed + begin / 8);
+    });
+
+    checkpointJob *job = new checkpointJob;
+    job->ret = -1;
+    std::string file(path);
+    job->thread = std::thread([job, header, packed, file]() {
+        job->ret = checkpoint_write(header, packed, file.c_str());
+        free(packed);
+    });
+
+    return job;
+}
+
+int checkpoint_wait(checkpointJob *job)
+{
+    job->thread.join();
+    int ret = job->ret;
+    delete job;
+    return ret;
+}
+
+int checkpoint_save(conway *c, const char *path)
+{
+    return checkpoint_wait(checkpoint_saveAsync(c, path));
+}
+
+int checkpoint_load(conway *c, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    checkpointHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, 8) ||
+        header.version != CHECKPOINT_VERSION ||
+        header.x < 0 || header.y < 0 || header.x > INT_MAX || header.y > INT_MAX ||
+        header.chunkCells <= 0 || header.chunkCells % 8 ||
+        header.chunkCount != (header.x * header.y + header.chunkCells - 1) / header.chunkCells)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    std::vector<int64_t> sizes(header.chunkCount);
+    if (fread(sizes.data(), sizeof(int64_t), sizes.size(), file) != sizes.size())
+    {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    // chunk offsets follow from the sizes, none larger than its packed cells could code to
+    long long cells = header.x * header.y;
+    std::vector<int64_t> offsets(header.chunkCount);
+    int64_t offset = sizeof(header) + header.chunkCount * sizeof(int64_t);
+    for (long long i = 0; i < header.chunkCount; i++)
+    {
+        long long begin = i * header.chunkCells;
+        long long count = begin + header.chunkCells < cells ? header.chunkCells : cells - begin;
+        if (sizes[i] < 0 || (uint64_t)sizes[i] > compress_rleBound((size_t)(count + 7) / 8))
+        {
+            return -1;
+        }
+
+        offsets[i] = offset;
+        offset += sizes[i];
+    }
+
+    conway_init(c, (char)header.wrap, (int)header.x, (int)header.y);
+    c->birth = (unsigned short)header.birth;
+    c->survive = (unsigned short)header.survive;
+    c->generation = header.generation;
+
+    std::atomic<bool> failed(false);
+    checkpoint_parallel(header.chunkCount, [&](long long i) {
+        long long begin = i * header.chunkCells;
+        long long count = begin + header.chunkCells < cells ? header.chunkCells : cells - begin;
+        size_t packedSize = (size_t)(count + 7) / 8;
+
+        // every thread reads its chunks through its own handle
+        FILE *in = fopen(path, "rb");
+        unsigned char *compressed = (unsigned char*)malloc((size_t)sizes[i]);
+        unsigned char *packed = (unsigned char*)malloc(packedSize);
+
+        if (!in || checkpoint_seek(in, offsets[i], SEEK_SET) ||
+            fread(compressed, 1, (size_t)sizes[i], in) != (size_t)sizes[i] ||
+            compress_unrle(compressed, (size_t)sizes[i], packed, packedSize) != (long long)packedSize)
+        {
+            failed = true;
+        }
+        else
+        {
+            compress_unpackBits(packed, (size_t)count, c->board + begin);
+        }
+
+        if (in)
+        {
+            fclose(in);
+        }
+        free(compressed);
+        free(packed);
+    });
+
+    if (failed)
+    {
+        conway_destroy(c);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "conway.h"
+
+/*
+    binary checkpoints of the full engine state
+    - dimensions, wrap, rule, generation counter and board
+    - the board is bit packed, then run length coded in independent chunks
+    - chunks are compressed and decompressed on all cores
+    - functions return 0 on success, -1 on error
+*/
+
+typedef struct checkpointJob checkpointJob;
+
+int checkpoint_save(conway *c, const char *path);
+
+// snapshot the board (bit packed, in parallel) and write it out in the background
+// the board can be stepped again as soon as this returns
+checkpointJob *checkpoint_saveAsync(conway *c, const char *path);
+int checkpoint_wait(checkpointJob *job);
+
+// initialize c from a checkpoint
+int checkpoint_load(conway *c, const char *path);
+
+#endif // CHECKPOINT_H
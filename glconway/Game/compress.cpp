@@ -0,0 +1,189 @@
+#include "compress.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COMPRESS_SSE2
+#endif
+
+/*
+    Bit packing
+*/
+
+void compress_packBits(const char *cells, size_t n, unsigned char *bits)
+{
+    size_t i = 0;
+
+#ifdef COMPRESS_SSE2
+    // 16 cells at a time: move bit 0 of each byte to the sign bit and gather
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(cells + i));
+        int mask = _mm_movemask_epi8(_mm_slli_epi16(v, 7));
+        bits[i / 8] = (unsigned char)mask;
+        bits[i / 8 + 1] = (unsigned char)(mask >> 8);
+    }
+#endif
+
+    for (; i < n; i += 8)
+    {
+        unsigned char byte = 0;
+        for (size_t j = 0; j < 8 && i + j < n; j++)
+        {
+            byte |= (cells[i + j] & 1) << j;
+        }
+        bits[i / 8] = byte;
+    }
+}
+
+void compress_unpackBits(const unsigned char *bits, size_t n, char *cells)
+{
+    for (size_t i = 0; i < n; i += 8)
+    {
+        unsigned char byte = bits[i / 8];
+        if (!byte && i + 8 <= n)
+        {
+            memset(cells + i, 0, 8);
+            continue;
+        }
+
+        for (size_t j = 0; j < 8 && i + j < n; j++)
+        {
+            cells[i + j] = (byte >> j) & 1;
+        }
+    }
+}
+
+/*
+    Run length coding
+
+    control byte c
+    - 0x00 - 0x7F: c + 1 literal bytes follow
+    - 0x80 - 0xFE: the next byte repeats c - 0x80 + 3 times
+    - 0xFF: a LEB128 count follows, then the byte to repeat
+*/
+
+#define COMPRESS_LITERAL 128
+#define COMPRESS_SHORTRUN (0xFE - 0x80 + 3)
+
+size_t compress_rleBound(size_t n)
+{
+    return n + n / COMPRESS_LITERAL + 16;
+}
+
+static size_t compress_literals(const unsigned char *in, size_t n, unsigned char *out)
+{
+    size_t len = 0;
+    while (n)
+    {
+        size_t count = n < COMPRESS_LITERAL ? n : COMPRESS_LITERAL;
+        out[len++] = (unsigned char)(count - 1);
+        memcpy(out + len, in, count);
+        len += count;
+        in += count;
+        n -= count;
+    }
+
+    return len;
+}
+
+size_t compress_rle(const unsigned char *in, size_t n, unsigned char *out)
+{
+    size_t len = 0;
+    size_t literal = 0; // start of pending literals
+    size_t i = 0;
+
+    while (i < n)
+    {
+        // length of the run starting here
+        size_t run = 1;
+        while (i + run < n && in[i + run] == in[i])
+        {
+            run++;
+        }
+
+        if (run < 3)
+        {
+            i += run;
+            continue;
+        }
+
+        len += compress_literals(in + literal, i - literal, out + len);
+
+        if (run <= COMPRESS_SHORTRUN)
+        {
+            out[len++] = (unsigned char)(0x80 + run - 3);
+        }
+        else
+        {
+            out[len++] = 0xFF;
+            for (size_t count = run; ; count >>= 7)
+            {
+                if (count < 0x80)
+                {
+                    out[len++] = (unsigned char)count;
+                    break;
+                }
+                out[len++] = (unsigned char)(0x80 | (count & 0x7F));
+            }
+        }
+        out[len++] = in[i];
+
+        i += run;
+        literal = i;
+    }
+
+    len += compress_literals(in + literal, n - literal, out + len);
+    return len;
+}
+
+long long compress_unrle(const unsigned char *in, size_t n, unsigned char *out, size_t outSize)
+{
+    size_t len = 0;
+    size_t i = 0;
+
+    while (i < n)
+    {
+        unsigned char c = in[i++];
+        if (c < 0x80)
+        {
+            size_t count = (size_t)c + 1;
+            if (i + count > n || len + count > outSize)
+            {
+                return -1;
+            }
+            memcpy(out + len, in + i, count);
+            i += count;
+            len += count;
+            continue;
+        }
+
+        size_t count = (size_t)c - 0x80 + 3;
+        if (c == 0xFF)
+        {
+            count = 0;
+            for (int shift = 0; ; shift += 7)
+            {
+                if (i >= n || shift > 56)
+                {
+                    return -1;
+                }
+                count |= (size_t)(in[i] & 0x7F) << shift;
+                if (!(in[i++] & 0x80))
+                {
+                    break;
+                }
+            }
+        }
+
+        if (i >= n || len + count > outSize)
+        {
+            return -1;
+        }
+        memset(out + len, in[i++], count);
+        len += count;
+    }
+
+    return (long long)len;
+}
@@ -0,0 +1,25 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+
+/*
+    board compression
+    - bit packing: 8 cells per byte, cell i in bit i % 8 of byte i / 8
+    - run length coding of bytes, suited to the long zero runs of packed boards
+*/
+
+// pack n cells (0 or 1) into (n + 7) / 8 bytes
+void compress_packBits(const char *cells, size_t n, unsigned char *bits);
+void compress_unpackBits(const unsigned char *bits, size_t n, char *cells);
+
+// largest output of compress_rle for n input bytes
+size_t compress_rleBound(size_t n);
+
+// returns the compressed size
+size_t compress_rle(const unsigned char *in, size_t n, unsigned char *out);
+
+// returns the decompressed size, or -1 if the input is malformed or doesn't fit
+long long compress_unrle(const unsigned char *in, size_t n, unsigned char *out, size_t outSize);
+
+#endif // COMPRESS_H
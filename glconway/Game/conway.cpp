@@ -3,6 +3,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CONWAY_SSE2
+#endif
 
 int mod(int n, int d)
 {
@@ -31,7 +52,7 @@ int conway_cell(conway *c, int x, int y)
         }
     }
 
-    return c->board[x * c->y + y];
+    return c->board[(size_t)x * c->y + y];
 }
 
 void conway_init(conway *c, char wrap, int x, int y)
@@ -49,21 +70,355 @@ void conway_init(conway *c, char wrap, int x, int y)
     c->wrap = wrap;
     c->x = x;
     c->y = y;
-    c->board = (char*)malloc(x * y);
-    memset(c->board, 0, x * y);
+    c->birth = 1 << 3;
+    c->survive = (1 << 2) | (1 << 3);
+    c->generation = 0;
+    c->next = NULL;
+    c->mapping = NULL;
+    c->changed = NULL;
+    c->density = NULL;
+    c->densityLevels = 0;
+    c->board = (char*)malloc((size_t)x * y);
+    memset(c->board, 0, (size_t)x * y);
+}
+
+// parse one half of a rule, digits without a B or S prefix go to plain
+static int conway_ruleHalf(const char *begin, const char *end, unsigned short *birth, unsigned short *survive, unsigned short *plain)
+{
+    unsigned short *mask = plain;
+    if (begin < end && (*begin == 'B' || *begin == 'b'))
+    {
+        mask = birth;
+        begin++;
+    }
+    else if (begin < end && (*begin == 'S' || *begin == 's'))
+    {
+        mask = survive;
+        begin++;
+    }
+
+    for (; begin < end; begin++)
+    {
+        if (*begin < '0' || *begin > '8')
+        {
+            return -1;
+        }
+        *mask |= 1 << (*begin - '0');
+    }
+
+    return 0;
+}
+
+// parse a rule in B/S notation ("B3/S23") or the older S/B notation ("23/3")
+int conway_setRule(conway *c, const char *rule)
+{
+    const char *slash = strchr(rule, '/');
+    if (!slash)
+    {
+        return -1;
+    }
+
+    unsigned short birth = 0;
+    unsigned short survive = 0;
+    if (conway_ruleHalf(rule, slash, &birth, &survive, &survive) ||
+        conway_ruleHalf(slash + 1, slash + 1 + strcspn(slash + 1, " \t\r\n"), &birth, &survive, &birth))
+    {
+        return -1;
+    }
+
+    c->birth = birth;
+    c->survive = survive;
+    return 0;
+}
+
+// write the rule in B/S notation, out needs room for 22 characters
+void conway_ruleString(conway *c, char *out)
+{
+    *out++ = 'B';
+    for (int i = 0; i <= 8; i++)
+    {
+        if (c->birth & (1 << i))
+        {
+            *out++ = '0' + i;
+        }
+    }
+
+    *out++ = '/';
+    *out++ = 'S';
+    for (int i = 0; i <= 8; i++)
+    {
+        if (c->survive & (1 << i))
+        {
+            *out++ = '0' + i;
+        }
+    }
+
+    *out = '\0';
+}
+
+/*
+    Memory mapped boards
+    - the file holds a header page, then the board and the next generation buffer
+    - stepping swaps the two halves, the header records which one is current
+*/
+
+#define CONWAY_MAPPED_MAGIC "CONWAYMM"
+#define CONWAY_MAPPED_VERSION 1
+#define CONWAY_PAGE 4096
+#define CONWAY_MAPPED_CHUNK (8 << 20) // bytes of board stepped between access hints
+
+typedef struct
+{
+    char magic[8];
+    int32_t version;
+    int32_t x;
+    int32_t y;
+    int32_t wrap;
+    int32_t birth;
+    int32_t survive;
+    int32_t current; // half holding the board
+    int64_t generation;
+} conwayMappedHeader;
+
+struct conwayMapping
+{
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE map;
+#else
+    int fd;
+#endif
+    char *base;
+    size_t size;
+    size_t half; // bytes per board, rounded up to a page
+};
+
+static size_t conway_pageRound(size_t n)
+{
+    return (n + CONWAY_PAGE - 1) / CONWAY_PAGE * CONWAY_PAGE;
+}
+
+// map size bytes of the file, growing it if create is set
+static conwayMapping *conway_map(const char *path, size_t size, int create)
+{
+    conwayMapping *m = (conwayMapping*)malloc(sizeof(conwayMapping));
+
+#ifdef _WIN32
+    m->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+        create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m->file == INVALID_HANDLE_VALUE)
+    {
+        free(m);
+        return NULL;
+    }
+
+    if (!size)
+    {
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(m->file, &fileSize);
+        size = (size_t)fileSize.QuadPart;
+    }
+
+    m->map = CreateFileMappingA(m->file, NULL, PAGE_READWRITE,
+        (DWORD)((unsigned long long)size >> 32), (DWORD)size, NULL);
+    m->base = m->map ? (char*)MapViewOfFile(m->map, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+    if (!m->base)
+    {
+        if (m->map)
+        {
+            CloseHandle(m->map);
+        }
+        CloseHandle(m->file);
+        free(m);
+        return NULL;
+    }
+#else
+    m->fd = open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+    if (m->fd < 0)
+    {
+        free(m);
+        return NULL;
+    }
+
+    if (create)
+    {
+        if (ftruncate(m->fd, (off_t)size))
+        {
+            close(m->fd);
+            free(m);
+            return NULL;
+        }
+    }
+    else
+    {
+        struct stat st;
+        fstat(m->fd, &st);
+        size = (size_t)st.st_size;
+    }
+
+    void *base = size ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0) : MAP_FAILED;
+    if (base == MAP_FAILED)
+    {
+        close(m->fd);
+        free(m);
+        return NULL;
+    }
+    m->base = (char*)base;
+
+    // stepping streams through both halves front to back
+    madvise(m->base, size, MADV_SEQUENTIAL);
+#endif
+
+    m->size = size;
+    return m;
+}
+
+static void conway_unmap(conwayMapping *m)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(m->base);
+    CloseHandle(m->map);
+    CloseHandle(m->file);
+#else
+    munmap(m->base, m->size);
+    close(m->fd);
+#endif
+    free(m);
+}
+
+// hint that [p, p + n) is about to be read (needed) or won't be for a while, widened to whole pages
+static void conway_advise(char *p, size_t n, int needed)
+{
+#ifndef _WIN32
+    uintptr_t begin = (uintptr_t)p / CONWAY_PAGE * CONWAY_PAGE;
+    uintptr_t end = ((uintptr_t)p + n + CONWAY_PAGE - 1) / CONWAY_PAGE * CONWAY_PAGE;
+    if (end > begin)
+    {
+        madvise((void*)begin, end - begin, needed ? MADV_WILLNEED : MADV_DONTNEED);
+    }
+#endif
+}
+
+static void conway_writeHeader(conway *c)
+{
+    conwayMappedHeader *header = (conwayMappedHeader*)c->mapping->base;
+    memcpy(header->magic, CONWAY_MAPPED_MAGIC, 8);
+    header->version = CONWAY_MAPPED_VERSION;
+    header->x = c->x;
+    header->y = c->y;
+    header->wrap = c->wrap;
+    header->birth = c->birth;
+    header->survive = c->survive;
+    header->current = c->board == c->mapping->base + CONWAY_PAGE ? 0 : 1;
+    header->generation = c->generation;
+}
+
+// create (or truncate) a board file and map the board from it
+int conway_initMapped(conway *c, char wrap, int x, int y, const char *path)
+{
+    if (!c || x < 0 || y < 0)
+    {
+        return -1;
+    }
+
+    size_t half = conway_pageRound((size_t)x * y);
+    conwayMapping *m = conway_map(path, CONWAY_PAGE + 2 * half, 1);
+    if (!m)
+    {
+        return -1;
+    }
+    m->half = half;
+
+    // a fresh file reads as zeros, so the board starts empty without touching it
+    c->wrap = wrap;
+    c->x = x;
+    c->y = y;
+    c->birth = 1 << 3;
+    c->survive = (1 << 2) | (1 << 3);
+    c->generation = 0;
+    c->mapping = m;
+    c->changed = NULL;
+    c->density = NULL;
+    c->densityLevels = 0;
+    c->board = m->base + CONWAY_PAGE;
+    c->next = c->board + half;
+    conway_writeHeader(c);
+
+    return 0;
+}
+
+// map an existing board file, nothing is parsed or copied
+int conway_openMapped(conway *c, const char *path)
+{
+    conwayMapping *m = conway_map(path, 0, 0);
+    if (!m)
+    {
+        return -1;
+    }
+
+    conwayMappedHeader *header = (conwayMappedHeader*)m->base;
+    if (m->size < sizeof(conwayMappedHeader) ||
+        memcmp(header->magic, CONWAY_MAPPED_MAGIC, 8) ||
+        header->version != CONWAY_MAPPED_VERSION ||
+        header->x <= 0 || header->y <= 0)
+    {
+        conway_unmap(m);
+        return -1;
+    }
+
+    // both dimensions are positive 32 bit values, so the product cannot wrap a size_t
+    size_t half = conway_pageRound((size_t)header->x * (size_t)header->y);
+    if (m->size < CONWAY_PAGE + 2 * half)
+    {
+        conway_unmap(m);
+        return -1;
+    }
+    m->half = half;
+
+    c->wrap = (char)header->wrap;
+    c->x = header->x;
+    c->y = header->y;
+    c->birth = (unsigned short)header->birth;
+    c->survive = (unsigned short)header->survive;
+    c->generation = header->generation;
+    c->mapping = m;
+    c->changed = NULL;
+    c->density = NULL;
+    c->densityLevels = 0;
+    c->board = m->base + CONWAY_PAGE + (header->current ? half : 0);
+    c->next = m->base + CONWAY_PAGE + (header->current ? 0 : half);
+
+    return 0;
+}
+
+// flush the header and board to disk
+int conway_syncMapped(conway *c)
+{
+    if (!c->mapping)
+    {
+        return -1;
+    }
+
+    conway_writeHeader(c);
+#ifdef _WIN32
+    return FlushViewOfFile(c->mapping->base, c->mapping->size) ? 0 : -1;
+#else
+    return msync(c->mapping->base, c->mapping->size, MS_SYNC);
+#endif
 }
 
 void conway_seed(conway *c, char *seed, char empty)
 {
-    for (int i = 0, n = c->x * c->y; i < n; i++)
+    for (size_t i = 0, n = (size_t)c->x * c->y; i < n; i++)
     {
         c->board[i] = seed[i] != empty ? 1 : 0;
     }
+    conway_markAllChanged(c);
 }
 
 void conway_seedTable(conway *c, char **seed, char empty)
 {
-    int i = 0;
+    size_t i = 0;
     // c->x strings
     for (int x = 0; x < c->x; x++)
     {
@@ -74,51 +429,242 @@ void conway_seedTable(conway *c, char **seed, char empty)
             i++;
         }
     }
+    conway_markAllChanged(c);
 }
 
-void conway_simulate(conway *c)
+// counter-based generator, the value for cell i only depends on seed and i
+static unsigned long long conway_random(unsigned long long seed, unsigned long long i)
 {
-    char *tmp = (char*)malloc(c->x * c->y);
+    unsigned long long z = seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
 
-    int i = 0;
-    for (int x = 0; x < c->x; x++)
+// fill with a random soup, the same for a given seed no matter how many threads fill it
+void conway_seedRandom(conway *c, double density, unsigned long long seed)
+{
+    size_t n = (size_t)c->x * c->y;
+
+    if (density <= 0.0 || density >= 1.0)
+    {
+        memset(c->board, density > 0.0 ? 1 : 0, n);
+        conway_markAllChanged(c);
+        return;
+    }
+
+    // live if the 64 bit value falls under density * 2^64
+    unsigned long long threshold = (unsigned long long)(density * 18446744073709551616.0);
+
+    unsigned int nThreads = std::thread::hardware_concurrency();
+    if (nThreads == 0)
+    {
+        nThreads = 1;
+    }
+
+    // one contiguous chunk per thread
+    size_t chunk = (n + nThreads - 1) / nThreads;
+    std::vector<std::thread> threads;
+    for (size_t begin = 0; begin < n; begin += chunk)
+    {
+        size_t end = begin + chunk < n ? begin + chunk : n;
+        threads.emplace_back([c, seed, threshold, begin, end]() {
+            for (size_t i = begin; i < end; i++)
+            {
+                c->board[i] = conway_random(seed, i) < threshold;
+            }
+        });
+    }
+
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    conway_markAllChanged(c);
+}
+
+// row x of board, NULL if it falls off a non-wrapping board
+static const char *conway_row(conway *c, const char *board, int x)
+{
+    if (x < 0 || x >= c->x)
+    {
+        if (!c->wrap)
+        {
+            return NULL;
+        }
+        x = mod(x, c->x);
+    }
+
+    return board + (size_t)x * c->y;
+}
+
+// write rows [x0, x1) of the generation after src into dst
+// tiles whose cells changed are stamped with generation in changed, if not NULL
+static void conway_stepRows(conway *c, const char *src, char *dst, int x0, int x1, long long generation, long long *changed)
+{
+    for (int x = x0; x < x1; x++)
     {
+        const char *rows[3] = {
+            conway_row(c, src, x - 1),
+            src + (size_t)x * c->y,
+            conway_row(c, src, x + 1)
+        };
+        char *out = dst + (size_t)x * c->y;
+
         for (int y = 0; y < c->y; y++)
         {
+            // neighboring columns, -1 if off a non-wrapping board
+            int left = y - 1;
+            int right = y + 1;
+            if (left < 0)
+            {
+                left = c->wrap ? c->y - 1 : -1;
+            }
+            if (right >= c->y)
+            {
+                right = c->wrap ? 0 : -1;
+            }
+
             int activeNeigbors = 0;
-            for (int xi = -1; xi <= 1; xi++)
+            for (int i = 0; i < 3; i++)
             {
-                for (int yi = -1; yi <= 1; yi++)
+                if (!rows[i])
                 {
-                    if ((xi || yi) && conway_cell(c, x + xi, y + yi))
-                    {
-                        activeNeigbors++;
-                    }
+                    continue;
+                }
+
+                if (left >= 0)
+                {
+                    activeNeigbors += rows[i][left];
+                }
+                if (i != 1)
+                {
+                    activeNeigbors += rows[i][y];
+                }
+                if (right >= 0)
+                {
+                    activeNeigbors += rows[i][right];
                 }
             }
 
-            if (c->board[i] && (activeNeigbors == 2 || activeNeigbors == 3))
+            if (rows[1][y])
             {
-                // live cells with 2 or 3 neighbors stay live
-                tmp[i] = 1;
+                // live cells stay live with a survival count
+                out[y] = (c->survive >> activeNeigbors) & 1;
             }
-            else if (!c->board[i] && activeNeigbors == 3)
+            else
             {
-                // dead cells with 3 neighbors become live
-                tmp[i] = 1;
+                // dead cells become live with a birth count
+                out[y] = (c->birth >> activeNeigbors) & 1;
             }
-            else
+        }
+
+        if (changed)
+        {
+            long long *stamps = changed + (size_t)(x / CONWAY_TILE) * conway_tileCols(c->y);
+            for (int y = 0; y < c->y; y += CONWAY_TILE)
             {
-                // all others remain dead
-                tmp[i] = 0;
+                int n = y + CONWAY_TILE < c->y ? CONWAY_TILE : c->y - y;
+                if (memcmp(out + y, rows[1] + y, n))
+                {
+                    stamps[y / CONWAY_TILE] = generation;
+                }
             }
+        }
+    }
+}
 
-            i++;
+static void conway_updateDensity(conway *c);
+static void conway_freeDensity(conway *c);
+
+// step a file backed board a chunk of rows at a time, reading ahead and dropping what's done
+static void conway_simulateMapped(conway *c)
+{
+    int chunkRows = c->y > 0 ? (int)(CONWAY_MAPPED_CHUNK / c->y) : 1;
+    if (chunkRows < 1)
+    {
+        chunkRows = 1;
+    }
+
+    for (int x0 = 0; x0 < c->x; x0 += chunkRows)
+    {
+        int x1 = x0 + chunkRows < c->x ? x0 + chunkRows : c->x;
+
+        // fault in the next chunk while this one is stepped
+        if (x1 < c->x)
+        {
+            int x2 = x1 + chunkRows < c->x ? x1 + chunkRows : c->x;
+            conway_advise(c->board + (size_t)x1 * c->y, (size_t)(x2 - x1) * c->y, 1);
+        }
+
+        conway_stepRows(c, c->board, c->next, x0, x1, c->generation + 1, c->changed);
+
+        // rows the next chunk won't read are done with (except the first, the last row wraps to it)
+        int done0 = x0 > 1 ? x0 - 1 : 1;
+        if (x1 - 1 > done0)
+        {
+            conway_advise(c->board + (size_t)done0 * c->y, (size_t)(x1 - 1 - done0) * c->y, 0);
+        }
+    }
+
+    char *tmp = c->board;
+    c->board = c->next;
+    c->next = tmp;
+}
+
+void conway_simulate(conway *c)
+{
+    if (c->mapping)
+    {
+        conway_simulateMapped(c);
+        c->generation++;
+        conway_writeHeader(c);
+        conway_updateDensity(c);
+        return;
+    }
+
+    // step into the spare buffer and swap, it is allocated once and kept
+    if (!c->next)
+    {
+        c->next = (char*)malloc((size_t)c->x * c->y);
+    }
+
+    conway_stepRows(c, c->board, c->next, 0, c->x, c->generation + 1, c->changed);
+
+    char *tmp = c->board;
+    c->board = c->next;
+    c->next = tmp;
+    c->generation++;
+    conway_updateDensity(c);
+}
+
+// write the next generation into next, leaving the board (and its change stamps) untouched
+void conway_simulateInto(conway *c, char *next, long long *stamps)
+{
+    conway_stepRows(c, c->board, next, 0, c->x, c->generation + 1, stamps);
+}
+
+char *conway_advance(conway *c, char *next, const long long *stamps)
+{
+    char *prev = c->board;
+    c->board = next;
+    c->generation++;
+
+    // without stamps every tile counts as changed
+    if (c->changed)
+    {
+        size_t tiles = (size_t)conway_tileRows(c->x) * conway_tileCols(c->y);
+        for (size_t i = 0; i < tiles; i++)
+        {
+            if (!stamps || stamps[i] == c->generation)
+            {
+                c->changed[i] = c->generation;
+            }
         }
     }
+    conway_updateDensity(c);
 
-    memcpy(c->board, tmp, c->x * c->y);
-    free(tmp);
+    return prev;
 }
 
 void conway_simulateN(conway *c, int n)
@@ -129,40 +675,692 @@ void conway_simulateN(conway *c, int n)
     }
 }
 
-void conway_destroy(conway *c)
+/*
+    wavefront stepping
+    - thread k computes generations k + 1, k + 1 + nThreads, ... in bands of rows
+    - each band only waits for the three bands it reads in the previous generation,
+      so nThreads generations are in flight at once, a few bands apart
+    - generation g starts at band g, so the wrapped top row is always finished in time
+*/
+void conway_simulateNWavefront(conway *c, int n, int nThreads, int bandRows)
 {
-    if (c && c->board)
+    if (n <= 0)
     {
-        c->x = 0;
-        c->y = 0;
-        free(c->board);
+        return;
     }
-}
 
-char **conway_print(conway *c, char live, char dead, char **ret)
-{
-    char allocate = 0;
-    if (!ret)
+    // the generations in flight would each need a board in memory
+    if (c->mapping)
     {
-        ret = (char**)malloc(c->x * sizeof(char *));
-        allocate = 1;
+        conway_simulateN(c, n);
+        return;
     }
 
-    int i = 0;
-    for (int x = 0; x < c->x; x++)
+    if (nThreads <= 0)
     {
-        if (allocate)
-        {
-            ret[x] = (char*)malloc(c->y * sizeof(char) + 1);
-        }
+        nThreads = (int)std::thread::hardware_concurrency();
+    }
+    if (nThreads > n)
+    {
+        nThreads = n;
+    }
+    if (nThreads <= 1)
+    {
+        conway_simulateN(c, n);
+        return;
+    }
 
-        for (int y = 0; y < c->y; y++)
+    if (bandRows <= 0)
+    {
+        // keep the bands in flight small enough to stay in cache
+        bandRows = c->y > 0 ? (int)(65536 / c->y) : 1;
+        if (bandRows < 1)
         {
-            ret[x][y] = c->board[i] ? live : dead;
-            i++;
+            bandRows = 1;
         }
-        ret[x][c->y] = '\0';
     }
+    int nBands = (c->x + bandRows - 1) / bandRows;
 
-    return ret;
-}
\ No newline at end of file
+    // generation g lives in buffers[g % nBuffers], enough that no one overwrites a generation still being read
+    int nBuffers = nThreads + 1;
+    size_t size = (size_t)c->x * c->y;
+    std::vector<char*> buffers(nBuffers);
+    buffers[0] = c->board;
+    for (int i = 1; i < nBuffers; i++)
+    {
+        buffers[i] = (char*)malloc(size);
+    }
+
+    // per thread: generation * nBands + bands finished in it
+    std::vector<std::atomic<long long>> progress(nThreads);
+    for (int i = 0; i < nThreads; i++)
+    {
+        progress[i].store(0);
+    }
+
+    std::vector<std::thread> threads;
+    for (int k = 0; k < nThreads; k++)
+    {
+        threads.emplace_back([&, k]() {
+            for (long long g = k + 1; g <= n; g += nThreads)
+            {
+                const char *src = buffers[(g - 1) % nBuffers];
+                char *dst = buffers[g % nBuffers];
+                std::atomic<long long> &prev = progress[(g - 2 + nThreads) % nThreads];
+
+                for (int i = 0; i < nBands; i++)
+                {
+                    // the band and its neighbors in the previous generation must be finished
+                    if (g > 1)
+                    {
+                        int needed = i + 3 < nBands ? i + 3 : nBands;
+                        while (prev.load(std::memory_order_acquire) < (g - 1) * nBands + needed)
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+
+                    int band = (int)((g + i) % nBands);
+                    int x0 = band * bandRows;
+                    int x1 = x0 + bandRows < c->x ? x0 + bandRows : c->x;
+                    conway_stepRows(c, src, dst, x0, x1, -1, NULL);
+
+                    progress[k].store(g * nBands + i + 1, std::memory_order_release);
+                }
+            }
+        });
+    }
+
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+
+    if (n % nBuffers)
+    {
+        memcpy(c->board, buffers[n % nBuffers], size);
+    }
+    for (int i = 1; i < nBuffers; i++)
+    {
+        free(buffers[i]);
+    }
+
+    c->generation += n;
+
+    // generations finish out of order, so every tile counts as changed
+    if (c->changed)
+    {
+        size_t tiles = (size_t)conway_tileRows(c->x) * conway_tileCols(c->y);
+        for (size_t i = 0; i < tiles; i++)
+        {
+            c->changed[i] = c->generation;
+        }
+    }
+    conway_updateDensity(c);
+}
+
+void conway_destroy(conway *c)
+{
+    if (c && c->mapping)
+    {
+        conway_writeHeader(c);
+        conway_unmap(c->mapping);
+        c->mapping = NULL;
+        c->board = NULL;
+        c->next = NULL;
+        c->x = 0;
+        c->y = 0;
+    }
+    else if (c && c->board)
+    {
+        c->x = 0;
+        c->y = 0;
+        free(c->board);
+        free(c->next);
+    }
+
+    if (c)
+    {
+        free(c->changed);
+        c->changed = NULL;
+        conway_freeDensity(c);
+    }
+}
+
+/*
+    live cells
+*/
+
+// index of the lowest set bit, mask being non zero
+static inline int conway_lowestBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (int)i;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+long long conway_population(conway *c)
+{
+    if (c->density && c->densityLevels > 0 && c->densityGeneration == c->generation)
+    {
+        // the top level's blocks, one unless the board is too large for a single block
+        size_t blocks = (size_t)conway_densityRows(c->x, c->densityLevels) * conway_densityCols(c->y, c->densityLevels);
+        long long n = 0;
+        for (size_t i = 0; i < blocks; i++)
+        {
+            n += c->density[c->densityLevels][i];
+        }
+        return n;
+    }
+
+    long long n = 0;
+    size_t size = (size_t)c->x * c->y;
+    size_t i = 0;
+#ifdef CONWAY_SSE2
+    // cells are 0 or 1, summed 16 at a time
+    __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i sums = _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(c->board + i)), zero);
+        n += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+    }
+#endif
+    for (; i < size; i++)
+    {
+        n += c->board[i];
+    }
+
+    return n;
+}
+
+long long conway_liveCells(conway *c, int *cells, long long maxCells)
+{
+    long long n = 0;
+    for (int x = 0; x < c->x; x++)
+    {
+        const char *row = c->board + (size_t)x * c->y;
+        int y = 0;
+
+#ifdef CONWAY_SSE2
+        // a bit per live cell in 16, scanned lowest first, empty stretches cost one compare
+        __m128i zero = _mm_setzero_si128();
+        for (; y + 16 <= c->y; y += 16)
+        {
+            unsigned int mask = (unsigned int)_mm_movemask_epi8(
+                _mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*)(row + y)), zero));
+            for (; mask; mask &= mask - 1)
+            {
+                if (n < maxCells)
+                {
+                    cells[2 * n] = x;
+                    cells[2 * n + 1] = y + conway_lowestBit(mask);
+                }
+                n++;
+            }
+        }
+#endif
+
+        for (; y < c->y; y++)
+        {
+            if (row[y])
+            {
+                if (n < maxCells)
+                {
+                    cells[2 * n] = x;
+                    cells[2 * n + 1] = y;
+                }
+                n++;
+            }
+        }
+    }
+
+    return n;
+}
+
+// map a row of cells to characters without branching on the cells
+static void conway_exportRow(const char *cells, int n, char live, char dead, char *out)
+{
+    int i = 0;
+    char flip = live ^ dead;
+
+#ifdef CONWAY_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i vdead = _mm_set1_epi8(dead);
+    __m128i vflip = _mm_set1_epi8(flip);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(cells + i));
+        __m128i alive = _mm_andnot_si128(_mm_cmpeq_epi8(v, zero), vflip);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(vdead, alive));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        out[i] = dead ^ (-(cells[i] != 0) & flip);
+    }
+}
+
+size_t conway_exportSize(int rows, int cols)
+{
+    return (size_t)(cols + 1) * rows;
+}
+
+long long conway_export(conway *c, char live, char dead, char *buf, size_t size,
+    int x0, int y0, int rows, int cols)
+{
+    if (x0 < 0 || y0 < 0 || rows < 0 || cols < 0 || x0 + rows > c->x || y0 + cols > c->y ||
+        size < conway_exportSize(rows, cols))
+    {
+        return -1;
+    }
+
+    char *out = buf;
+    for (int x = x0; x < x0 + rows; x++)
+    {
+        conway_exportRow(c->board + (size_t)x * c->y + y0, cols, live, dead, out);
+        out += cols;
+        *out++ = '\n';
+    }
+
+    return out - buf;
+}
+
+char **conway_print(conway *c, char live, char dead, char **ret)
+{
+    char allocate = 0;
+    if (!ret)
+    {
+        ret = (char**)malloc(c->x * sizeof(char *));
+        allocate = 1;
+    }
+
+    size_t i = 0;
+    for (int x = 0; x < c->x; x++)
+    {
+        if (allocate)
+        {
+            ret[x] = (char*)malloc(c->y * sizeof(char) + 1);
+        }
+
+        conway_exportRow(c->board + i, c->y, live, dead, ret[x]);
+        i += c->y;
+        ret[x][c->y] = '\0';
+    }
+
+    return ret;
+}
+
+/*
+    change tracking
+*/
+
+int conway_tileRows(int x)
+{
+    return (x + CONWAY_TILE - 1) / CONWAY_TILE;
+}
+
+int conway_tileCols(int y)
+{
+    return (y + CONWAY_TILE - 1) / CONWAY_TILE;
+}
+
+void conway_trackChanges(conway *c)
+{
+    size_t tiles = (size_t)conway_tileRows(c->x) * conway_tileCols(c->y);
+    free(c->changed);
+    c->changed = (long long*)malloc(tiles * sizeof(long long));
+    for (size_t i = 0; i < tiles; i++)
+    {
+        c->changed[i] = c->generation;
+    }
+}
+
+void conway_markChanged(conway *c, conwayRect rect)
+{
+    if (!c->changed)
+    {
+        return;
+    }
+
+    int x0 = rect.x > 0 ? rect.x : 0;
+    int y0 = rect.y > 0 ? rect.y : 0;
+    int x1 = rect.x + rect.rows < c->x ? rect.x + rect.rows : c->x;
+    int y1 = rect.y + rect.cols < c->y ? rect.y + rect.cols : c->y;
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    int tileCols = conway_tileCols(c->y);
+    for (int tr = x0 / CONWAY_TILE; tr <= (x1 - 1) / CONWAY_TILE; tr++)
+    {
+        for (int tc = y0 / CONWAY_TILE; tc <= (y1 - 1) / CONWAY_TILE; tc++)
+        {
+            c->changed[(size_t)tr * tileCols + tc] = c->generation + 1;
+        }
+    }
+
+    // the board may have been moved back to an earlier generation
+    if (c->density && c->densityGeneration > c->generation)
+    {
+        c->densityGeneration = c->generation;
+    }
+    conway_updateDensity(c);
+}
+
+void conway_markAllChanged(conway *c)
+{
+    conwayRect all = { 0, 0, c->x, c->y };
+    conway_markChanged(c, all);
+}
+
+// bounding rectangle of the changed tiles
+static conwayRect conway_changedBounds(const long long *changed, int x, int y, long long since)
+{
+    int tileRows = conway_tileRows(x);
+    int tileCols = conway_tileCols(y);
+    int tr0 = tileRows, tc0 = tileCols, tr1 = 0, tc1 = 0;
+    for (int tr = 0; tr < tileRows; tr++)
+    {
+        for (int tc = 0; tc < tileCols; tc++)
+        {
+            if (changed[(size_t)tr * tileCols + tc] > since)
+            {
+                tr0 = tr < tr0 ? tr : tr0;
+                tc0 = tc < tc0 ? tc : tc0;
+                tr1 = tr + 1 > tr1 ? tr + 1 : tr1;
+                tc1 = tc + 1 > tc1 ? tc + 1 : tc1;
+            }
+        }
+    }
+
+    conwayRect r = { tr0 * CONWAY_TILE, tc0 * CONWAY_TILE, 0, 0 };
+    r.rows = (tr1 * CONWAY_TILE < x ? tr1 * CONWAY_TILE : x) - r.x;
+    r.cols = (tc1 * CONWAY_TILE < y ? tc1 * CONWAY_TILE : y) - r.y;
+    return r;
+}
+
+int conway_changedRects(const long long *changed, int x, int y, long long since,
+    conwayRect *rects, int maxRects)
+{
+    int tileRows = conway_tileRows(x);
+    int tileCols = conway_tileCols(y);
+
+    int n = 0;
+    for (int tr = 0; tr < tileRows; tr++)
+    {
+        const long long *stamps = changed + (size_t)tr * tileCols;
+        for (int tc = 0; tc < tileCols; )
+        {
+            if (stamps[tc] <= since)
+            {
+                tc++;
+                continue;
+            }
+
+            // run of changed tiles along the row
+            int tc0 = tc;
+            while (tc < tileCols && stamps[tc] > since)
+            {
+                tc++;
+            }
+            conwayRect run = { tr * CONWAY_TILE, tc0 * CONWAY_TILE, 0, 0 };
+            run.rows = ((tr + 1) * CONWAY_TILE < x ? (tr + 1) * CONWAY_TILE : x) - run.x;
+            run.cols = (tc * CONWAY_TILE < y ? tc * CONWAY_TILE : y) - run.y;
+
+            // extend a rectangle ending on the row above that spans the same columns
+            int i = 0;
+            while (i < n && !(rects[i].x + rects[i].rows == run.x && rects[i].y == run.y && rects[i].cols == run.cols))
+            {
+                i++;
+            }
+            if (i < n)
+            {
+                rects[i].rows += run.rows;
+            }
+            else if (n < maxRects)
+            {
+                rects[n++] = run;
+            }
+            else
+            {
+                if (maxRects <= 0)
+                {
+                    return 0;
+                }
+                rects[0] = conway_changedBounds(changed, x, y, since);
+                return 1;
+            }
+        }
+    }
+
+    return n;
+}
+
+/*
+    density pyramid
+*/
+
+int conway_densityRows(int x, int level)
+{
+    return (int)(((long long)x + (1LL << level) - 1) >> level);
+}
+
+int conway_densityCols(int y, int level)
+{
+    return conway_densityRows(y, level);
+}
+
+int conway_densityLevels(int x, int y)
+{
+    int levels = 1;
+    while (levels < CONWAY_DENSITY_MAX_LEVELS &&
+        (conway_densityRows(x, levels) > 1 || conway_densityCols(y, levels) > 1))
+    {
+        levels++;
+    }
+
+    return levels;
+}
+
+static void conway_freeDensity(conway *c)
+{
+    if (!c->density)
+    {
+        return;
+    }
+
+    for (int k = 1; k <= c->densityLevels; k++)
+    {
+        free(c->density[k]);
+    }
+    free(c->density);
+    c->density = NULL;
+    c->densityLevels = 0;
+}
+
+// recount block (i, j) of level k from the level below
+static void conway_densityBlock(conway *c, int k, int i, int j)
+{
+    unsigned int count = 0;
+    if (k == 1)
+    {
+        int x1 = 2 * i + 2 < c->x ? 2 * i + 2 : c->x;
+        int y1 = 2 * j + 2 < c->y ? 2 * j + 2 : c->y;
+        for (int x = 2 * i; x < x1; x++)
+        {
+            for (int y = 2 * j; y < y1; y++)
+            {
+                count += c->board[(size_t)x * c->y + y];
+            }
+        }
+    }
+    else
+    {
+        int rows = conway_densityRows(c->x, k - 1);
+        int cols = conway_densityCols(c->y, k - 1);
+        const unsigned int *below = c->density[k - 1];
+        int x1 = 2 * i + 2 < rows ? 2 * i + 2 : rows;
+        int y1 = 2 * j + 2 < cols ? 2 * j + 2 : cols;
+        for (int x = 2 * i; x < x1; x++)
+        {
+            for (int y = 2 * j; y < y1; y++)
+            {
+                count += below[(size_t)x * cols + y];
+            }
+        }
+    }
+
+    c->density[k][(size_t)i * conway_densityCols(c->y, k) + j] = count;
+}
+
+void conway_trackDensity(conway *c)
+{
+    if (!c->changed)
+    {
+        conway_trackChanges(c);
+    }
+
+    conway_freeDensity(c);
+    c->densityLevels = conway_densityLevels(c->x, c->y);
+    c->density = (unsigned int**)malloc((c->densityLevels + 1) * sizeof(unsigned int*));
+    c->density[0] = NULL; // the board itself
+
+    for (int k = 1; k <= c->densityLevels; k++)
+    {
+        int rows = conway_densityRows(c->x, k);
+        int cols = conway_densityCols(c->y, k);
+        c->density[k] = (unsigned int*)malloc((size_t)rows * cols * sizeof(unsigned int));
+        for (int i = 0; i < rows; i++)
+        {
+            for (int j = 0; j < cols; j++)
+            {
+                conway_densityBlock(c, k, i, j);
+            }
+        }
+    }
+
+    c->densityGeneration = c->generation;
+}
+
+// tiles are 2^CONWAY_TILE_LEVEL cells a side, so the levels up to it split evenly into tiles
+#define CONWAY_TILE_LEVEL 5
+static_assert(1 << CONWAY_TILE_LEVEL == CONWAY_TILE, "tiles must be a power of two cells a side");
+
+// recount the blocks over tiles changed since the pyramid was last counted
+static void conway_updateDensity(conway *c)
+{
+    if (!c->density || !c->changed)
+    {
+        return;
+    }
+
+    // changed tiles, as row << 32 | column
+    std::vector<unsigned long long> blocks;
+    int tileRows = conway_tileRows(c->x);
+    int tileCols = conway_tileCols(c->y);
+    for (int tr = 0; tr < tileRows; tr++)
+    {
+        for (int tc = 0; tc < tileCols; tc++)
+        {
+            if (c->changed[(size_t)tr * tileCols + tc] > c->densityGeneration)
+            {
+                blocks.push_back((unsigned long long)tr << 32 | (unsigned int)tc);
+            }
+        }
+    }
+
+    // levels within a tile
+    int k = 1;
+    for (; k <= c->densityLevels && k <= CONWAY_TILE_LEVEL; k++)
+    {
+        int rows = conway_densityRows(c->x, k);
+        int cols = conway_densityCols(c->y, k);
+        int span = CONWAY_TILE >> k;
+        for (unsigned long long b : blocks)
+        {
+            int i0 = (int)(b >> 32) * span;
+            int j0 = (int)(unsigned int)b * span;
+            int i1 = i0 + span < rows ? i0 + span : rows;
+            int j1 = j0 + span < cols ? j0 + span : cols;
+            for (int i = i0; i < i1; i++)
+            {
+                for (int j = j0; j < j1; j++)
+                {
+                    conway_densityBlock(c, k, i, j);
+                }
+            }
+        }
+    }
+
+    // levels above, each changed block's parent once
+    for (; k <= c->densityLevels; k++)
+    {
+        for (unsigned long long &b : blocks)
+        {
+            b = (b >> 33) << 32 | ((unsigned int)b >> 1);
+        }
+        std::sort(blocks.begin(), blocks.end());
+        blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+        for (unsigned long long b : blocks)
+        {
+            conway_densityBlock(c, k, (int)(b >> 32), (int)(unsigned int)b);
+        }
+    }
+
+    c->densityGeneration = c->generation;
+}
+
+void conway_densityWindow(conway *c, int level, int x0, int y0, int rows, int cols, unsigned char *out)
+{
+    if (level == 0)
+    {
+        for (int i = 0; i < rows; i++)
+        {
+            const char *cells = c->board + (size_t)(x0 + i) * c->y + y0;
+            unsigned char *dst = out + (size_t)i * cols;
+            for (int j = 0; j < cols; j++)
+            {
+                dst[j] = cells[j] ? 255 : 0;
+            }
+        }
+        return;
+    }
+
+    int levelCols = conway_densityCols(c->y, level);
+    bool kept = c->density && level <= c->densityLevels && c->densityGeneration == c->generation;
+    for (int i = 0; i < rows; i++)
+    {
+        unsigned char *dst = out + (size_t)i * cols;
+        for (int j = 0; j < cols; j++)
+        {
+            unsigned long long count = 0;
+            if (kept)
+            {
+                count = c->density[level][(size_t)(x0 + i) * levelCols + y0 + j];
+            }
+            else
+            {
+                // no pyramid, count the block's cells
+                long long x0Cell = (long long)(x0 + i) << level;
+                long long y0Cell = (long long)(y0 + j) << level;
+                long long x1 = x0Cell + (1LL << level) < c->x ? x0Cell + (1LL << level) : c->x;
+                long long y1 = y0Cell + (1LL << level) < c->y ? y0Cell + (1LL << level) : c->y;
+                for (long long x = x0Cell; x < x1; x++)
+                {
+                    for (long long y = y0Cell; y < y1; y++)
+                    {
+                        count += c->board[(size_t)x * c->y + y];
+                    }
+                }
+            }
+            dst[j] = (unsigned char)((count * 255) >> (2 * level));
+        }
+    }
+}
@@ -1,8 +1,25 @@
 #ifndef CONWAY_H
 #define CONWAY_H
 
+#include <stddef.h>
+
 int mod(int n, int d);
 
+// file backing a memory mapped board
+typedef struct conwayMapping conwayMapping;
+
+// change tracking granularity, in cells along both axes
+#define CONWAY_TILE 32
+
+// rectangle of cells, rows [x, x + rows) and columns [y, y + cols)
+typedef struct
+{
+    int x;
+    int y;
+    int rows;
+    int cols;
+} conwayRect;
+
 typedef struct
 {
     int x;
@@ -10,20 +27,104 @@ typedef struct
 
     char wrap;
 
+    // rule as neighbor count bitmasks, B3/S23 by default
+    unsigned short birth;
+    unsigned short survive;
+
     char *board;
+
+    // spare buffer the next generation is written to and swapped with the board,
+    // allocated on the first step (part of the file for mapped boards)
+    char *next;
+
+    // set for boards living in a file
+    conwayMapping *mapping;
+
+    long long generation;
+
+    // generation each CONWAY_TILE square last changed in, NULL unless tracking
+    long long *changed;
+
+    // population of each 2^k x 2^k block for levels k = 1 .. densityLevels, NULL unless tracking
+    unsigned int **density;
+    int densityLevels;
+    long long densityGeneration; // of the board the pyramid counts
 } conway;
 
 int conway_cell(conway *c, int x, int y);
 
 void conway_init(conway *c, char wrap, int x, int y);
+int conway_initMapped(conway *c, char wrap, int x, int y, const char *path);
+int conway_openMapped(conway *c, const char *path);
+int conway_syncMapped(conway *c);
+int conway_setRule(conway *c, const char *rule);
+void conway_ruleString(conway *c, char *out);
 void conway_seed(conway *c, char *seed, char empty);
 void conway_seedTable(conway *c, char **seed, char empty);
+void conway_seedRandom(conway *c, double density, unsigned long long seed);
 
 void conway_simulate(conway *c);
+// step into next without touching the board, stamping the tiles that change into stamps
+// (conway_tileRows x conway_tileCols, NULL for none) rather than the board's own
+void conway_simulateInto(conway *c, char *next, long long *stamps);
+// make next, stepped by conway_simulateInto, the board, taking the tiles stamped as changed
+// (every tile if stamps is NULL), returns the buffer it replaced
+char *conway_advance(conway *c, char *next, const long long *stamps);
 void conway_simulateN(conway *c, int n);
+// steps one generation at a time instead for mapped boards, which could not hold the generations in flight
+void conway_simulateNWavefront(conway *c, int n, int nThreads, int bandRows);
 
 void conway_destroy(conway *c);
 
+// start recording which tiles each step changes, every tile counts as changed now
+void conway_trackChanges(conway *c);
+int conway_tileRows(int x);
+int conway_tileCols(int y);
+
+// cells in rect were written between steps: their tiles are stamped as changing with the next
+// generation, so a frame of the current one is sent again, and the density pyramid is recounted
+// over them; does nothing unless tracking
+void conway_markChanged(conway *c, conwayRect rect);
+// the whole board
+void conway_markAllChanged(conway *c);
+
+// tiles changed after generation since, merged into at most maxRects rectangles
+// adjacent tiles in a row join, then runs spanning the same columns join across rows
+// if more are needed a single bounding rectangle is returned
+int conway_changedRects(const long long *changed, int x, int y, long long since,
+    conwayRect *rects, int maxRects);
+
+/*
+    density pyramid
+    - level k counts the live cells in each 2^k x 2^k block, level 0 being the cells themselves
+    - each step recounts the blocks of the tiles it changed and their parents, so keeping it
+      costs about as much as the change tracking it builds on
+    - levels stop at a single block, or where a block's population would no longer fit
+*/
+#define CONWAY_DENSITY_MAX_LEVELS 15
+
+// start keeping the pyramid (and tracking changes), counting the board as it is now
+void conway_trackDensity(conway *c);
+int conway_densityLevels(int x, int y);
+// blocks along each axis at a level
+int conway_densityRows(int x, int level);
+int conway_densityCols(int y, int level);
+
+// blocks [x0, x0 + rows) x [y0, y0 + cols) of a level as bytes, 255 for a full block, row after row
+// read from the pyramid when kept, otherwise counted from the cells
+void conway_densityWindow(conway *c, int level, int x0, int y0, int rows, int cols, unsigned char *out);
+
+// live cells, from the density pyramid when kept
+long long conway_population(conway *c);
+// row and column of up to maxCells live cells, row after row, returns how many there are in all
+long long conway_liveCells(conway *c, int *cells, long long maxCells);
+
 char **conway_print(conway *c, char live, char dead, char **ret);
 
+// text of a rectangle of rows x cols cells, each row ended by a newline
+size_t conway_exportSize(int rows, int cols);
+// returns the bytes written, -1 if the rectangle is off the board or buf is too small
+long long conway_export(conway *c, char live, char dead, char *buf, size_t size,
+    int x0, int y0, int rows, int cols);
+
 #endif // CONWAY_H
\ No newline at end of file
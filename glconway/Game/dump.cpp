@@ -0,0 +1,718 @@
+#include "dump.h"
+#include "compress.h"
+#include "threadPool.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <malloc.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// build with DUMP_NO_URING to always use the thread pool writer
+#if defined(__linux__) && !defined(DUMP_NO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define DUMP_URING
+#endif
+
+#define DUMP_MAGIC "CONWAYDP"
+#define DUMP_VERSION 1
+#define DUMP_BUFFERS 8
+#define DUMP_WRITERS 2
+#define DUMP_KEYFRAME 256 // most deltas in a row, so readers can start close to any generation
+#define DUMP_ALIGN 4096
+
+#define DUMP_RECORD_PACKED 0
+#define DUMP_RECORD_DELTA 1
+
+/*
+    file layout
+    - header
+    - records, in push order: record header, then the packed board or the run length coded delta
+*/
+typedef struct
+{
+    char magic[8];
+    int64_t version;
+    int64_t x;
+    int64_t y;
+    int64_t mode;
+} dumpHeader;
+
+typedef struct
+{
+    int64_t generation;
+    int64_t kind;
+    int64_t size;
+} dumpRecord;
+
+#ifdef DUMP_URING
+typedef struct
+{
+    int fd;
+
+    void *sq;
+    size_t sqSize;
+    void *cq;
+    size_t cqSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+} dumpUring;
+#endif
+
+// a buffer's write in progress
+typedef struct
+{
+    size_t length;
+    size_t written;
+    long long offset;
+} dumpWrite;
+
+struct dump
+{
+    dumpMode mode;
+    int x;
+    int y;
+    size_t packedSize;
+
+    // packed boards of the last and the current generation
+    unsigned char *previous;
+    unsigned char *packed;
+    long long previousGeneration;
+    int sinceKeyframe;
+
+#ifdef _WIN32
+    HANDLE file;
+#else
+    int file;
+#endif
+    long long offset; // of the next record
+
+    size_t bufferSize;
+    std::vector<unsigned char*> buffers;
+    std::vector<dumpWrite> writes;
+    std::vector<int> free;
+
+    std::mutex lock;
+    std::condition_variable released;
+    dumpStats stats;
+    bool failed;
+    std::chrono::steady_clock::time_point opened;
+
+#ifdef DUMP_URING
+    dumpUring ring;
+#endif
+    threadPool pool;
+    threadPoolGroup group;
+};
+
+static unsigned char *dump_alignedAlloc(size_t size)
+{
+#ifdef _WIN32
+    return (unsigned char*)_aligned_malloc(size, DUMP_ALIGN);
+#else
+    void *ptr = NULL;
+    return posix_memalign(&ptr, DUMP_ALIGN, size) ? NULL : (unsigned char*)ptr;
+#endif
+}
+
+static void dump_alignedFree(unsigned char *ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// write all of data at offset, returns 0 on success
+static int dump_pwrite(dump *d, const unsigned char *data, size_t size, long long offset)
+{
+    while (size)
+    {
+#ifdef _WIN32
+        OVERLAPPED at = {};
+        at.Offset = (DWORD)offset;
+        at.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD written = 0;
+        DWORD chunk = size < 0x40000000 ? (DWORD)size : 0x40000000;
+        if (!WriteFile(d->file, data, chunk, &written, &at) || !written)
+        {
+            return -1;
+        }
+#else
+        ssize_t written = pwrite(d->file, data, size, (off_t)offset);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return -1;
+        }
+#endif
+        data += written;
+        size -= written;
+        offset += written;
+    }
+
+    return 0;
+}
+
+// a buffer's write finished, call with the lock held
+static void dump_release(dump *d, int i, bool ok)
+{
+    d->failed = d->failed || !ok;
+    d->stats.bytes += ok ? d->writes[i].length : 0;
+    d->stats.queueDepth--;
+    d->free.push_back(i);
+    d->released.notify_one();
+}
+
+/*
+    io_uring
+*/
+
+#ifdef DUMP_URING
+static int dump_uringInit(dumpUring *r, unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0)
+    {
+        return -1;
+    }
+
+    r->sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single)
+    {
+        r->sqSize = r->cqSize = r->sqSize > r->cqSize ? r->sqSize : r->cqSize;
+    }
+
+    r->sq = mmap(NULL, r->sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->cq = single ? r->sq : mmap(NULL, r->cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = (struct io_uring_sqe*)mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sq == MAP_FAILED || r->cq == MAP_FAILED || r->sqes == MAP_FAILED)
+    {
+        // unmapping whatever did succeed is left to dump_uringDestroy
+        return -1;
+    }
+
+    char *sq = (char*)r->sq;
+    char *cq = (char*)r->cq;
+    r->sqTail = (unsigned*)(sq + p.sq_off.tail);
+    r->sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+    r->sqArray = (unsigned*)(sq + p.sq_off.array);
+    r->cqHead = (unsigned*)(cq + p.cq_off.head);
+    r->cqTail = (unsigned*)(cq + p.cq_off.tail);
+    r->cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+    return 0;
+}
+
+static void dump_uringDestroy(dumpUring *r)
+{
+    if (r->sqes && r->sqes != MAP_FAILED)
+    {
+        munmap(r->sqes, r->sqesSize);
+    }
+    if (r->cq && r->cq != MAP_FAILED && r->cq != r->sq)
+    {
+        munmap(r->cq, r->cqSize);
+    }
+    if (r->sq && r->sq != MAP_FAILED)
+    {
+        munmap(r->sq, r->sqSize);
+    }
+    if (r->fd >= 0)
+    {
+        close(r->fd);
+    }
+    r->fd = -1;
+}
+
+static int dump_uringEnter(dumpUring *r, unsigned submit, unsigned wait)
+{
+    for (;;)
+    {
+        long ret = syscall(__NR_io_uring_enter, r->fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret >= 0 || errno != EINTR)
+        {
+            return ret < 0 ? -1 : 0;
+        }
+    }
+}
+
+// queue the unwritten part of buffer i
+static int dump_uringSubmit(dump *d, int i)
+{
+    dumpUring *r = &d->ring;
+    dumpWrite *w = &d->writes[i];
+
+    // each buffer has at most one write queued, and the ring has room for all of them
+    unsigned tail = *r->sqTail;
+    unsigned index = tail & *r->sqMask;
+    struct io_uring_sqe *sqe = r->sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = d->file;
+    sqe->addr = (unsigned long long)(uintptr_t)(d->buffers[i] + w->written);
+    sqe->len = (unsigned)(w->length - w->written);
+    sqe->off = (unsigned long long)(w->offset + w->written);
+    sqe->buf_index = (unsigned short)i;
+    sqe->user_data = (unsigned long long)i;
+
+    r->sqArray[index] = index;
+    __atomic_store_n(r->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    return dump_uringEnter(r, 1, 0);
+}
+
+// handle finished writes, waiting for at least one if wait is set
+static int dump_uringReap(dump *d, bool wait)
+{
+    dumpUring *r = &d->ring;
+    if (wait && dump_uringEnter(r, 0, 1))
+    {
+        d->failed = true;
+        return -1;
+    }
+
+    unsigned head = *r->cqHead;
+    unsigned tail = __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqe = r->cqes + (head & *r->cqMask);
+        int i = (int)cqe->user_data;
+        dumpWrite *w = &d->writes[i];
+
+        if (cqe->res > 0)
+        {
+            w->written += cqe->res;
+        }
+
+        // short writes continue where they stopped
+        bool done = cqe->res <= 0 || w->written == w->length;
+        if (!done && dump_uringSubmit(d, i))
+        {
+            done = true;
+            cqe->res = -1;
+        }
+
+        if (done)
+        {
+            std::lock_guard<std::mutex> guard(d->lock);
+            dump_release(d, i, cqe->res > 0);
+        }
+    }
+    __atomic_store_n(r->cqHead, head, __ATOMIC_RELEASE);
+
+    return 0;
+}
+#endif
+
+/*
+    Dumping
+*/
+
+dump *dump_open(conway *c, const char *path, dumpMode mode, int buffers)
+{
+    if (buffers <= 0)
+    {
+        buffers = DUMP_BUFFERS;
+    }
+
+    dump *d = new dump;
+    d->mode = mode;
+    d->x = c->x;
+    d->y = c->y;
+    d->packedSize = ((size_t)c->x * c->y + 7) / 8;
+
+#ifdef _WIN32
+    d->file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (d->file == INVALID_HANDLE_VALUE)
+#else
+    d->file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (d->file < 0)
+#endif
+    {
+        delete d;
+        return NULL;
+    }
+
+    dumpHeader header;
+    memcpy(header.magic, DUMP_MAGIC, 8);
+    header.version = DUMP_VERSION;
+    header.x = c->x;
+    header.y = c->y;
+    header.mode = mode;
+    d->failed = dump_pwrite(d, (const unsigned char*)&header, sizeof(header), 0) != 0;
+    d->offset = sizeof(header);
+
+    d->previous = (unsigned char*)malloc(d->packedSize);
+    d->packed = (unsigned char*)malloc(d->packedSize);
+    d->previousGeneration = -1;
+    d->sinceKeyframe = 0;
+
+    // room for a record holding the larger of a packed board and a delta
+    size_t bound = compress_rleBound(d->packedSize);
+    size_t record = sizeof(dumpRecord) + (bound > d->packedSize ? bound : d->packedSize);
+    d->bufferSize = (record + DUMP_ALIGN - 1) / DUMP_ALIGN * DUMP_ALIGN;
+    for (int i = 0; i < buffers; i++)
+    {
+        d->buffers.push_back(dump_alignedAlloc(d->bufferSize));
+        d->free.push_back(buffers - 1 - i);
+    }
+    d->writes.resize(buffers);
+
+    memset(&d->stats, 0, sizeof(d->stats));
+    d->opened = std::chrono::steady_clock::now();
+
+#ifdef DUMP_URING
+    // registering the buffers pins them for the lifetime of the ring
+    memset(&d->ring, 0, sizeof(d->ring));
+    d->ring.fd = -1;
+    if (!dump_uringInit(&d->ring, (unsigned)buffers))
+    {
+        std::vector<struct iovec> iov(buffers);
+        for (int i = 0; i < buffers; i++)
+        {
+            iov[i].iov_base = d->buffers[i];
+            iov[i].iov_len = d->bufferSize;
+        }
+        d->stats.uring = syscall(__NR_io_uring_register, d->ring.fd, IORING_REGISTER_BUFFERS, iov.data(), buffers) == 0;
+    }
+    if (!d->stats.uring)
+    {
+        dump_uringDestroy(&d->ring);
+    }
+#endif
+
+    if (!d->stats.uring)
+    {
+        threadPool_init(&d->pool, DUMP_WRITERS + 1);
+        d->group.pending.store(0);
+    }
+
+    return d;
+}
+
+// take a free buffer, waiting for a write to finish if there is none
+static int dump_acquire(dump *d)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool waited = false;
+
+#ifdef DUMP_URING
+    if (d->stats.uring)
+    {
+        dump_uringReap(d, false);
+        while (d->free.empty() && !d->failed)
+        {
+            waited = true;
+            if (dump_uringReap(d, true))
+            {
+                return -1;
+            }
+        }
+    }
+#endif
+
+    std::unique_lock<std::mutex> guard(d->lock);
+    if (d->free.empty())
+    {
+        waited = true;
+        d->released.wait(guard, [d] { return !d->free.empty() || d->failed; });
+    }
+
+    if (waited)
+    {
+        d->stats.stalled += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (d->failed)
+    {
+        return -1;
+    }
+
+    int i = d->free.back();
+    d->free.pop_back();
+    d->stats.queueDepth++;
+    d->stats.maxQueueDepth = d->stats.queueDepth > d->stats.maxQueueDepth ? d->stats.queueDepth : d->stats.maxQueueDepth;
+    d->stats.frames++;
+    return i;
+}
+
+int dump_push(dump *d, conway *c)
+{
+    if (c->x != d->x || c->y != d->y)
+    {
+        return -1;
+    }
+
+    int i = dump_acquire(d);
+    if (i < 0)
+    {
+        return -1;
+    }
+
+    unsigned char *buffer = d->buffers[i];
+    dumpRecord *record = (dumpRecord*)buffer;
+    unsigned char *data = buffer + sizeof(dumpRecord);
+
+    compress_packBits(c->board, (size_t)d->x * d->y, d->packed);
+
+    bool keyframe = d->mode == DUMP_PACKED || d->previousGeneration < 0 ||
+        c->generation != d->previousGeneration + 1 ||
+        d->sinceKeyframe == DUMP_KEYFRAME;
+    if (keyframe)
+    {
+        memcpy(data, d->packed, d->packedSize);
+        record->kind = DUMP_RECORD_PACKED;
+        record->size = (int64_t)d->packedSize;
+        d->sinceKeyframe = 0;
+    }
+    else
+    {
+        for (size_t j = 0; j < d->packedSize; j++)
+        {
+            d->previous[j] ^= d->packed[j];
+        }
+        record->kind = DUMP_RECORD_DELTA;
+        record->size = (int64_t)compress_rle(d->previous, d->packedSize, data);
+        d->sinceKeyframe++;
+    }
+    record->generation = c->generation;
+
+    unsigned char *swap = d->previous;
+    d->previous = d->packed;
+    d->packed = swap;
+    d->previousGeneration = c->generation;
+
+    dumpWrite *w = &d->writes[i];
+    w->length = sizeof(dumpRecord) + (size_t)record->size;
+    w->written = 0;
+    w->offset = d->offset;
+
+    // the next record only moves past this one once its write is queued
+#ifdef DUMP_URING
+    if (d->stats.uring)
+    {
+        if (dump_uringSubmit(d, i))
+        {
+            std::lock_guard<std::mutex> guard(d->lock);
+            dump_release(d, i, false);
+            return -1;
+        }
+        d->offset += w->length;
+        return 0;
+    }
+#endif
+
+    threadPool_spawn(&d->pool, &d->group, [d, i] {
+        dumpWrite *w = &d->writes[i];
+        bool ok = !dump_pwrite(d, d->buffers[i], w->length, w->offset);
+
+        std::lock_guard<std::mutex> guard(d->lock);
+        dump_release(d, i, ok);
+    });
+    d->offset += w->length;
+
+    return 0;
+}
+
+void dump_stats(dump *d, dumpStats *stats)
+{
+    std::lock_guard<std::mutex> guard(d->lock);
+    *stats = d->stats;
+    stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - d->opened).count();
+}
+
+int dump_close(dump *d, dumpStats *stats)
+{
+#ifdef DUMP_URING
+    if (d->stats.uring)
+    {
+        // the kernel may still be reading the buffers until every write completes
+        while (d->stats.queueDepth > 0)
+        {
+            if (dump_uringReap(d, true))
+            {
+                break;
+            }
+        }
+        dump_uringDestroy(&d->ring);
+    }
+#endif
+
+    if (!d->stats.uring)
+    {
+        threadPool_wait(&d->pool, &d->group);
+        threadPool_destroy(&d->pool);
+    }
+
+    if (stats)
+    {
+        dump_stats(d, stats);
+    }
+
+#ifdef _WIN32
+    bool failed = !CloseHandle(d->file) || d->failed;
+#else
+    bool failed = close(d->file) || d->failed;
+#endif
+
+    for (unsigned char *buffer : d->buffers)
+    {
+        dump_alignedFree(buffer);
+    }
+    free(d->previous);
+    free(d->packed);
+
+    delete d;
+    return failed ? -1 : 0;
+}
+
+/*
+    Reading
+*/
+
+struct dumpReader
+{
+    FILE *file;
+    int x;
+    int y;
+    size_t packedSize;
+
+    // packed board of the last record read, deltas apply to it
+    unsigned char *packed;
+    unsigned char *delta;
+    unsigned char *record;
+    size_t recordSize; // largest record written, as in dump_open
+    bool started;
+};
+
+dumpReader *dump_openReader(const char *path, int *x, int *y)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+
+    dumpHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, DUMP_MAGIC, 8) ||
+        header.version != DUMP_VERSION ||
+        header.x <= 0 || header.y <= 0 || header.x > INT32_MAX || header.y > INT32_MAX)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    dumpReader *r = new dumpReader;
+    r->file = file;
+    r->x = (int)header.x;
+    r->y = (int)header.y;
+    r->packedSize = ((size_t)r->x * r->y + 7) / 8;
+    r->packed = (unsigned char*)malloc(r->packedSize);
+    r->delta = (unsigned char*)malloc(r->packedSize);
+    size_t bound = compress_rleBound(r->packedSize);
+    r->recordSize = bound > r->packedSize ? bound : r->packedSize;
+    r->record = (unsigned char*)malloc(r->recordSize);
+    r->started = false;
+
+    *x = r->x;
+    *y = r->y;
+    return r;
+}
+
+int dump_read(dumpReader *r, conway *c)
+{
+    if (c->x != r->x || c->y != r->y)
+    {
+        return -1;
+    }
+
+    dumpRecord record;
+    size_t got = fread(&record, 1, sizeof(record), r->file);
+    if (!got && feof(r->file))
+    {
+        return 0;
+    }
+    if (got != sizeof(record) || record.size < 0 || (size_t)record.size > r->recordSize)
+    {
+        return -1;
+    }
+    if (fread(r->record, 1, (size_t)record.size, r->file) != (size_t)record.size)
+    {
+        return -1;
+    }
+
+    if (record.kind == DUMP_RECORD_PACKED)
+    {
+        if ((size_t)record.size != r->packedSize)
+        {
+            return -1;
+        }
+        memcpy(r->packed, r->record, r->packedSize);
+    }
+    else if (record.kind == DUMP_RECORD_DELTA && r->started)
+    {
+        if (compress_unrle(r->record, (size_t)record.size, r->delta, r->packedSize) != (long long)r->packedSize)
+        {
+            return -1;
+        }
+        for (size_t j = 0; j < r->packedSize; j++)
+        {
+            r->packed[j] ^= r->delta[j];
+        }
+    }
+    else
+    {
+        return -1;
+    }
+    r->started = true;
+
+    compress_unpackBits(r->packed, (size_t)r->x * r->y, c->board);
+    c->generation = record.generation;
+    conway_markAllChanged(c);
+    return 1;
+}
+
+void dump_closeReader(dumpReader *r)
+{
+    fclose(r->file);
+    free(r->packed);
+    free(r->delta);
+    free(r->record);
+    delete r;
+}
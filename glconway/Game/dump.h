@@ -0,0 +1,57 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+#include "conway.h"
+
+/*
+    asynchronous generation dump
+    - every pushed generation becomes a record: the bit packed board, or its run length coded XOR with the previous one
+    - records are built in a fixed pool of page aligned buffers and written at increasing file offsets
+    - on Linux writes go through io_uring from registered (pinned) buffers
+    - elsewhere, or when io_uring is unavailable, a thread pool writes with positional writes
+    - pushing blocks while every buffer is waiting on the disk
+*/
+typedef enum
+{
+    DUMP_PACKED,
+    DUMP_DELTA
+} dumpMode;
+
+typedef struct
+{
+    long long frames;  // pushed
+    long long bytes;   // written
+    double seconds;    // since opening
+    double stalled;    // spent waiting for a free buffer
+    int queueDepth;    // writes in flight
+    int maxQueueDepth;
+    bool uring;
+} dumpStats;
+
+typedef struct dump dump;
+
+// buffers <= 0 picks a default, returns NULL if the file cannot be created
+dump *dump_open(conway *c, const char *path, dumpMode mode, int buffers);
+
+// returns -1 once a write has failed
+int dump_push(dump *d, conway *c);
+
+void dump_stats(dump *d, dumpStats *stats);
+
+// wait for every write and close, stats (if not NULL) gets the final totals, returns -1 if any write failed
+int dump_close(dump *d, dumpStats *stats);
+
+/*
+    reading a dump back, one generation at a time in the order pushed
+*/
+typedef struct dumpReader dumpReader;
+
+// returns NULL if the file is not a dump, x and y get the board's dimensions
+dumpReader *dump_openReader(const char *path, int *x, int *y);
+
+// next generation into c (same dimensions), returns 1, 0 at the end of the dump or -1 on a bad record
+int dump_read(dumpReader *r, conway *c);
+
+void dump_closeReader(dumpReader *r);
+
+#endif // DUMP_H
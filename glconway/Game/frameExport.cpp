@@ -0,0 +1,493 @@
+#include "frameExport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#define frameExport_popen(command) _popen(command, "wb")
+#define frameExport_pclose _pclose
+#else
+#define frameExport_popen(command) popen(command, "w")
+#define frameExport_pclose pclose
+#endif
+
+typedef struct
+{
+    long long sequence;
+    long long generation;
+    char *cells; // rows x cols, cropped
+} frameExportFrame;
+
+struct frameExport
+{
+    frameExportSettings settings;
+    std::string path;
+    int width; // pixels
+    int height;
+
+    FILE *stream; // NULL for one file per frame
+    bool pipe;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<frameExportFrame> pending;
+    long long pushed;
+    long long written; // frames written to the stream, in order
+    int inFlight; // queued or being encoded
+    bool closing;
+    bool failed;
+
+    std::vector<std::thread> encoders;
+};
+
+void frameExport_defaults(frameExportSettings *settings, frameExportFormat format, const char *path)
+{
+    settings->format = format;
+    settings->path = path;
+    settings->scale = 1;
+    settings->x0 = 0;
+    settings->y0 = 0;
+    settings->rows = 0;
+    settings->cols = 0;
+    settings->threads = 0;
+    settings->queue = 8;
+    settings->fps = 30;
+}
+
+static void frameExport_put(std::vector<unsigned char> &out, const void *data, size_t size)
+{
+    out.insert(out.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+}
+
+static void frameExport_put32(std::vector<unsigned char> &out, unsigned int v)
+{
+    unsigned char bytes[4] = { (unsigned char)(v >> 24), (unsigned char)(v >> 16), (unsigned char)(v >> 8), (unsigned char)v };
+    frameExport_put(out, bytes, 4);
+}
+
+static unsigned int frameExport_crc(const unsigned char *data, size_t size)
+{
+    static const std::vector<unsigned int> table = [] {
+        std::vector<unsigned int> t(256);
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            unsigned int c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    unsigned int crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// one row of pixels, 8 bit
+static void frameExport_grayRow(frameExport *e, const char *cells, unsigned char *out)
+{
+    int scale = e->settings.scale;
+    for (int y = 0; y < e->settings.cols; y++)
+    {
+        memset(out + (size_t)y * scale, cells[y] ? 0xFF : 0x00, scale);
+    }
+}
+
+// one row of pixels, 1 bit, most significant first
+static void frameExport_bitRow(frameExport *e, const char *cells, unsigned char *out, bool liveBit)
+{
+    memset(out, 0, ((size_t)e->width + 7) / 8);
+    for (int p = 0; p < e->width; p++)
+    {
+        if ((cells[p / e->settings.scale] != 0) == liveBit)
+        {
+            out[p >> 3] |= 0x80 >> (p & 7);
+        }
+    }
+}
+
+// zlib stream of stored deflate blocks
+static void frameExport_zlib(const std::vector<unsigned char> &raw, std::vector<unsigned char> &out)
+{
+    unsigned char header[2] = { 0x78, 0x01 };
+    frameExport_put(out, header, 2);
+
+    size_t offset = 0;
+    do
+    {
+        size_t size = raw.size() - offset < 0xFFFF ? raw.size() - offset : 0xFFFF;
+        unsigned char block[5] = {
+            (unsigned char)(offset + size == raw.size()),
+            (unsigned char)size, (unsigned char)(size >> 8),
+            (unsigned char)~size, (unsigned char)(~size >> 8)
+        };
+        frameExport_put(out, block, 5);
+        frameExport_put(out, raw.data() + offset, size);
+        offset += size;
+    } while (offset < raw.size());
+
+    // adler32
+    unsigned int a = 1;
+    unsigned int b = 0;
+    for (size_t i = 0; i < raw.size(); )
+    {
+        // largest run before the sums can overflow
+        size_t end = i + 5552 < raw.size() ? i + 5552 : raw.size();
+        for (; i < end; i++)
+        {
+            a += raw[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    frameExport_put32(out, (b << 16) | a);
+}
+
+static void frameExport_pngChunk(std::vector<unsigned char> &out, const char *type, const std::vector<unsigned char> &data)
+{
+    frameExport_put32(out, (unsigned int)data.size());
+    size_t start = out.size();
+    frameExport_put(out, type, 4);
+    frameExport_put(out, data.data(), data.size());
+    frameExport_put32(out, frameExport_crc(out.data() + start, out.size() - start));
+}
+
+static void frameExport_encode(frameExport *e, const char *cells, std::vector<unsigned char> &out)
+{
+    int scale = e->settings.scale;
+    int cols = e->settings.cols;
+    size_t bitRow = ((size_t)e->width + 7) / 8;
+
+    switch (e->settings.format)
+    {
+    case FRAMEEXPORT_PBM:
+    {
+        char header[64];
+        frameExport_put(out, header, sprintf(header, "P4\n%d %d\n", e->width, e->height));
+
+        // 1 is black
+        std::vector<unsigned char> row(bitRow);
+        for (int x = 0; x < e->settings.rows; x++)
+        {
+            frameExport_bitRow(e, cells + (size_t)x * cols, row.data(), false);
+            for (int s = 0; s < scale; s++)
+            {
+                frameExport_put(out, row.data(), bitRow);
+            }
+        }
+        break;
+    }
+    case FRAMEEXPORT_PNG:
+    {
+        static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        frameExport_put(out, signature, 8);
+
+        // 1 bit grayscale
+        std::vector<unsigned char> ihdr;
+        frameExport_put32(ihdr, e->width);
+        frameExport_put32(ihdr, e->height);
+        unsigned char format[5] = { 1, 0, 0, 0, 0 };
+        frameExport_put(ihdr, format, 5);
+        frameExport_pngChunk(out, "IHDR", ihdr);
+
+        // scanlines, each behind a "none" filter byte
+        std::vector<unsigned char> raw;
+        raw.reserve((bitRow + 1) * e->height);
+        std::vector<unsigned char> row(bitRow + 1, 0);
+        for (int x = 0; x < e->settings.rows; x++)
+        {
+            frameExport_bitRow(e, cells + (size_t)x * cols, row.data() + 1, true);
+            for (int s = 0; s < scale; s++)
+            {
+                frameExport_put(raw, row.data(), row.size());
+            }
+        }
+
+        std::vector<unsigned char> idat;
+        frameExport_zlib(raw, idat);
+        frameExport_pngChunk(out, "IDAT", idat);
+        frameExport_pngChunk(out, "IEND", std::vector<unsigned char>());
+        break;
+    }
+    case FRAMEEXPORT_Y4M:
+    case FRAMEEXPORT_GRAY:
+    {
+        if (e->settings.format == FRAMEEXPORT_Y4M)
+        {
+            frameExport_put(out, "FRAME\n", 6);
+        }
+
+        std::vector<unsigned char> row(e->width);
+        out.reserve(out.size() + (size_t)e->width * e->height);
+        for (int x = 0; x < e->settings.rows; x++)
+        {
+            frameExport_grayRow(e, cells + (size_t)x * cols, row.data());
+            for (int s = 0; s < scale; s++)
+            {
+                frameExport_put(out, row.data(), row.size());
+            }
+        }
+        break;
+    }
+    }
+}
+
+// a per frame path must take the generation through exactly one integer conversion (%d, %06lld, ...),
+// rewritten to %lld so it matches the argument; %% stays a literal percent sign
+static int frameExport_framePattern(const char *path, std::string *out)
+{
+    out->clear();
+    int conversions = 0;
+    for (const char *p = path; *p; p++)
+    {
+        if (*p != '%')
+        {
+            *out += *p;
+            continue;
+        }
+
+        if (p[1] == '%')
+        {
+            *out += "%%";
+            p++;
+            continue;
+        }
+
+        // flags and width, then an optional l or ll
+        std::string spec = "%";
+        p++;
+        while (*p == '0' || *p == '-' || *p == '+' || *p == ' ')
+        {
+            spec += *p++;
+        }
+        while (*p >= '0' && *p <= '9')
+        {
+            spec += *p++;
+        }
+        if (spec.size() > 4)
+        {
+            // more than two digits of width would not fit the path buffer
+            return -1;
+        }
+        if (*p == 'l')
+        {
+            p++;
+            if (*p == 'l')
+            {
+                p++;
+            }
+        }
+        if (*p != 'd' && *p != 'i' && *p != 'u')
+        {
+            return -1;
+        }
+
+        *out += spec + "lld";
+        conversions++;
+    }
+
+    return conversions == 1 ? 0 : -1;
+}
+
+static void frameExport_encoder(frameExport *e)
+{
+    std::vector<unsigned char> data;
+    std::vector<char> path(e->path.size() + 32);
+
+    for (;;)
+    {
+        std::unique_lock<std::mutex> guard(e->lock);
+        e->changed.wait(guard, [e] { return !e->pending.empty() || e->closing; });
+        if (e->pending.empty())
+        {
+            return;
+        }
+        frameExportFrame frame = e->pending.front();
+        e->pending.pop_front();
+        guard.unlock();
+
+        data.clear();
+        frameExport_encode(e, frame.cells, data);
+        free(frame.cells);
+
+        bool ok;
+        if (e->stream)
+        {
+            // stream frames go out in order
+            guard.lock();
+            e->changed.wait(guard, [e, &frame] { return e->written == frame.sequence; });
+            ok = fwrite(data.data(), 1, data.size(), e->stream) == data.size();
+            e->written++;
+        }
+        else
+        {
+            snprintf(path.data(), path.size(), e->path.c_str(), frame.generation);
+            FILE *file = fopen(path.data(), "wb");
+            ok = file && fwrite(data.data(), 1, data.size(), file) == data.size();
+            ok = file && !fclose(file) && ok;
+            guard.lock();
+        }
+
+        e->failed = e->failed || !ok;
+        e->inFlight--;
+        e->changed.notify_all();
+    }
+}
+
+frameExport *frameExport_open(conway *c, frameExportSettings *settings)
+{
+    frameExportSettings s = *settings;
+    if (!s.rows)
+    {
+        s.rows = c->x - s.x0;
+    }
+    if (!s.cols)
+    {
+        s.cols = c->y - s.y0;
+    }
+    if (s.x0 < 0 || s.y0 < 0 || s.rows <= 0 || s.cols <= 0 || s.x0 + s.rows > c->x || s.y0 + s.cols > c->y ||
+        s.scale <= 0 || !s.path)
+    {
+        return NULL;
+    }
+    if (s.threads <= 0)
+    {
+        s.threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+    }
+    if (s.queue <= 0)
+    {
+        s.queue = 1;
+    }
+
+    bool stream = s.format == FRAMEEXPORT_Y4M || s.format == FRAMEEXPORT_GRAY;
+    std::string path = s.path;
+    if (!stream && frameExport_framePattern(s.path, &path))
+    {
+        return NULL;
+    }
+
+    frameExport *e = new frameExport;
+    e->settings = s;
+    e->path = path;
+    e->width = s.cols * s.scale;
+    e->height = s.rows * s.scale;
+    e->stream = NULL;
+    e->pipe = false;
+
+    if (stream)
+    {
+        if (e->path == "-")
+        {
+            e->stream = stdout;
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        }
+        else if (e->path[0] == '|')
+        {
+            e->stream = frameExport_popen(e->path.c_str() + 1);
+            e->pipe = true;
+        }
+        else
+        {
+            e->stream = fopen(e->path.c_str(), "wb");
+        }
+
+        if (!e->stream)
+        {
+            delete e;
+            return NULL;
+        }
+
+        if (s.format == FRAMEEXPORT_Y4M)
+        {
+            fprintf(e->stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 Cmono\n", e->width, e->height, s.fps > 0 ? s.fps : 30);
+        }
+    }
+
+    e->pushed = 0;
+    e->written = 0;
+    e->inFlight = 0;
+    e->closing = false;
+    e->failed = false;
+    for (int i = 0; i < s.threads; i++)
+    {
+        e->encoders.emplace_back(frameExport_encoder, e);
+    }
+
+    return e;
+}
+
+int frameExport_push(frameExport *e, conway *c)
+{
+    frameExportSettings *s = &e->settings;
+
+    frameExportFrame frame;
+    frame.generation = c->generation;
+    frame.cells = (char*)malloc((size_t)s->rows * s->cols);
+    for (int x = 0; x < s->rows; x++)
+    {
+        memcpy(frame.cells + (size_t)x * s->cols, c->board + (size_t)(s->x0 + x) * c->y + s->y0, s->cols);
+    }
+
+    std::unique_lock<std::mutex> guard(e->lock);
+    e->changed.wait(guard, [e] { return e->inFlight < e->settings.queue; });
+    if (e->failed)
+    {
+        free(frame.cells);
+        return -1;
+    }
+
+    frame.sequence = e->pushed++;
+    e->pending.push_back(frame);
+    e->inFlight++;
+    e->changed.notify_all();
+
+    return 0;
+}
+
+int frameExport_close(frameExport *e)
+{
+    {
+        std::lock_guard<std::mutex> guard(e->lock);
+        e->closing = true;
+        e->changed.notify_all();
+    }
+    for (std::thread &t : e->encoders)
+    {
+        t.join();
+    }
+
+    bool failed = e->failed;
+    if (e->stream == stdout)
+    {
+        failed = fflush(stdout) || failed;
+    }
+    else if (e->pipe)
+    {
+        failed = frameExport_pclose(e->stream) || failed;
+    }
+    else if (e->stream)
+    {
+        failed = fclose(e->stream) || failed;
+    }
+
+    delete e;
+    return failed ? -1 : 0;
+}
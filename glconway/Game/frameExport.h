@@ -0,0 +1,57 @@
+#ifndef FRAMEEXPORT_H
+#define FRAMEEXPORT_H
+
+#include "conway.h"
+
+/*
+    headless frame export
+    - PBM (P4) and PNG write one file per frame, path is a pattern taking the generation through
+      exactly one integer conversion ("frame%06lld.png"), %% for a literal percent sign
+    - y4m (mono) and raw 8 bit grayscale are one stream, path is a file, "-" for stdout or "|command" for a pipe
+    - every cell becomes scale x scale pixels, live cells white
+    - pushing copies the cropped cells, encoding and writing happen on background threads
+    - at most queue frames are in flight, pushing blocks beyond that
+*/
+typedef enum
+{
+    FRAMEEXPORT_PBM,
+    FRAMEEXPORT_PNG,
+    FRAMEEXPORT_Y4M,
+    FRAMEEXPORT_GRAY
+} frameExportFormat;
+
+typedef struct
+{
+    frameExportFormat format;
+    const char *path;
+
+    int scale;
+
+    // cells exported, rows or cols 0 for the rest of the board
+    int x0;
+    int y0;
+    int rows;
+    int cols;
+
+    int threads;
+    int queue;
+
+    int fps; // y4m frame rate
+} frameExportSettings;
+
+typedef struct frameExport frameExport;
+
+// default settings: whole board, scale 1, one encoder per core
+void frameExport_defaults(frameExportSettings *settings, frameExportFormat format, const char *path);
+
+// returns NULL if the crop is off the board, a per frame path has no single integer conversion,
+// or the stream cannot be opened
+frameExport *frameExport_open(conway *c, frameExportSettings *settings);
+
+// queue the current generation, returns -1 once a write has failed
+int frameExport_push(frameExport *e, conway *c);
+
+// finish queued frames and close, returns -1 if any write failed
+int frameExport_close(frameExport *e);
+
+#endif // FRAMEEXPORT_H
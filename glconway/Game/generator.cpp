@@ -0,0 +1,91 @@
+#include "generator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "threadPool.h"
+
+namespace {
+    // owns the lookahead buffers and the worker, waits for background work and restores c->board on exit
+    struct lookaheadState {
+        conway* c;
+        char* board; // buffer c->board pointed to when the generator started
+        char* next;
+        long long* stamps; // tiles the step into next changed, NULL unless c tracks changes
+
+        // one worker for the whole run, the consumer's thread counts as the pool's other thread
+        threadPool pool;
+        threadPoolGroup pending;
+
+        lookaheadState(conway* c)
+            : c(c), board(c->board), stamps(NULL) {
+            next = (char*)malloc((size_t)c->x * c->y);
+            if (c->changed) {
+                size_t tiles = (size_t)conway_tileRows(c->x) * conway_tileCols(c->y);
+                stamps = (long long*)malloc(tiles * sizeof(long long));
+                for (size_t i = 0; i < tiles; i++) {
+                    stamps[i] = -1;
+                }
+            }
+
+            threadPool_init(&pool, 2);
+            pending.pending.store(0);
+        }
+
+        ~lookaheadState() {
+            threadPool_wait(&pool, &pending);
+            threadPool_destroy(&pool);
+
+            // leave the latest generation in the caller's buffer
+            if (c->board != board) {
+                memcpy(board, c->board, (size_t)c->x * c->y);
+                next = c->board;
+                c->board = board;
+            }
+            free(next);
+            free(stamps);
+        }
+    };
+}
+
+conwayGenerator conway_generate(conway* c, long long n, bool lookahead) {
+    conwayView view = { c->x, c->y, c->generation, c->board };
+
+    if (!lookahead) {
+        co_yield view;
+
+        while (n < 0 || n-- > 0) {
+            conway_simulate(c);
+            view.board = c->board;
+            view.generation = c->generation;
+            co_yield view;
+        }
+
+        co_return;
+    }
+
+    lookaheadState state(c);
+
+    while (true) {
+        bool more = n < 0 || n-- > 0;
+
+        if (more) {
+            // compute the next generation while the consumer looks at this one
+            threadPool_spawn(&state.pool, &state.pending, [&state] {
+                conway_simulateInto(state.c, state.next, state.stamps);
+            });
+        }
+
+        view.board = c->board;
+        view.generation = c->generation;
+        co_yield view;
+
+        if (!more) {
+            break;
+        }
+
+        // swap in the finished generation, with the tiles it changed
+        threadPool_wait(&state.pool, &state.pending);
+        state.next = conway_advance(c, state.next, state.stamps);
+    }
+}
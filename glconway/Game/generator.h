@@ -0,0 +1,118 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+
+#include "conway.h"
+
+/*
+    read-only view of one generation
+    - valid until the generator is resumed
+*/
+typedef struct
+{
+    int x;
+    int y;
+
+    long long generation;
+
+    const char *board;
+} conwayView;
+
+/*
+    generator of successive generations (C++20 coroutine)
+
+    for (const conwayView &view : conway_generate(&c, 100, true)) {
+        ...
+    }
+*/
+class conwayGenerator {
+public:
+    struct promise_type {
+        const conwayView* current = nullptr;
+        std::exception_ptr exception;
+
+        conwayGenerator get_return_object() {
+            return conwayGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        std::suspend_always yield_value(const conwayView& view) noexcept {
+            current = &view;
+            return {};
+        }
+
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    class iterator {
+    public:
+        explicit iterator(std::coroutine_handle<promise_type> handle = nullptr)
+            : handle(handle) {}
+
+        const conwayView& operator*() const { return *handle.promise().current; }
+        const conwayView* operator->() const { return handle.promise().current; }
+
+        iterator& operator++() {
+            handle.resume();
+            rethrow();
+            return *this;
+        }
+
+        bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+
+    private:
+        friend class conwayGenerator;
+
+        void rethrow() const {
+            if (handle.done() && handle.promise().exception) {
+                std::rethrow_exception(handle.promise().exception);
+            }
+        }
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    conwayGenerator(conwayGenerator&& other) noexcept
+        : handle(other.handle) {
+        other.handle = nullptr;
+    }
+
+    conwayGenerator(const conwayGenerator&) = delete;
+    conwayGenerator& operator=(const conwayGenerator&) = delete;
+
+    ~conwayGenerator() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    iterator begin() {
+        iterator it(handle);
+        handle.resume();
+        it.rethrow();
+        return it;
+    }
+
+    std::default_sentinel_t end() { return {}; }
+
+private:
+    explicit conwayGenerator(std::coroutine_handle<promise_type> handle)
+        : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/*
+    yield the current generation of c, then each of the next n generations (forever if n < 0)
+    - the board is advanced in place, c ends on the last generation yielded
+    - with lookahead, generation t + 1 is computed in the background while the consumer holds t
+*/
+conwayGenerator conway_generate(conway* c, long long n, bool lookahead);
+
+#endif // GENERATOR_H
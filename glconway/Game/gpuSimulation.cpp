@@ -0,0 +1,114 @@
+#include "gpuSimulation.h"
+#include "renderer.h"
+
+// a texel per cell, nearest so the integer texture is complete
+static GLuint gpuSimulation_genTexture(int x, int y, const char* board) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, y, x, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, board);
+    return texture;
+}
+
+int gpuSimulation_init(gpuSimulation* g, conway* c) {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (c->x <= 0 || c->y <= 0 || c->x > maxSize || c->y > maxSize) {
+        return -1;
+    }
+
+    g->program = genShaderProgram("texture.vs", "life.fs", NULL);
+    if (g->program == (GLuint)-1) {
+        return -1;
+    }
+
+    g->x = c->x;
+    g->y = c->y;
+    g->generation = c->generation;
+    g->current = 0;
+
+    glUseProgram(g->program);
+    glUniform1i(glGetUniformLocation(g->program, "board"), 0);
+    glUniform1i(glGetUniformLocation(g->program, "wrap"), c->wrap ? 1 : 0);
+    glUniform1i(glGetUniformLocation(g->program, "birth"), c->birth);
+    glUniform1i(glGetUniformLocation(g->program, "survive"), c->survive);
+
+    // the full-screen triangle needs no attributes, but core profile draws need a vertex array
+    glGenVertexArrays(1, &g->VAO);
+
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+
+    bool complete = true;
+    glGenFramebuffers(2, g->framebuffers);
+    for (int i = 0; i < 2; i++) {
+        g->textures[i] = gpuSimulation_genTexture(c->x, c->y, i == 0 ? c->board : NULL);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, g->framebuffers[i]);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g->textures[i], 0);
+        complete = complete && glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    if (!complete) {
+        gpuSimulation_destroy(g);
+        return -1;
+    }
+
+    return 0;
+}
+
+void gpuSimulation_step(gpuSimulation* g, int n) {
+    GLint framebuffer = 0;
+    GLint viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glViewport(0, 0, g->y, g->x);
+    glUseProgram(g->program);
+    glBindVertexArray(g->VAO);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int i = 0; i < n; i++) {
+        // read the current generation, write the other
+        int next = 1 - g->current;
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, g->framebuffers[next]);
+        glBindTexture(GL_TEXTURE_2D, g->textures[g->current]);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        g->current = next;
+    }
+    g->generation += n;
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+GLuint gpuSimulation_texture(gpuSimulation* g) {
+    return g->textures[g->current];
+}
+
+void gpuSimulation_read(gpuSimulation* g, conway* c) {
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &framebuffer);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, g->framebuffers[g->current]);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, g->y, g->x, GL_RED_INTEGER, GL_UNSIGNED_BYTE, c->board);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+
+    // the steps weren't tracked, so every tile changed
+    c->generation = g->generation;
+    conway_markAllChanged(c);
+}
+
+void gpuSimulation_destroy(gpuSimulation* g) {
+    glDeleteFramebuffers(2, g->framebuffers);
+    glDeleteTextures(2, g->textures);
+    glDeleteVertexArrays(1, &g->VAO);
+    glDeleteProgram(g->program);
+}
@@ -0,0 +1,43 @@
+#ifndef GPUSIMULATION_H
+#define GPUSIMULATION_H
+
+#include <glad/glad.h>
+
+#include "conway.h"
+
+/*
+    generations stepped on the GPU
+    - the board lives in two R8UI textures, a texel per cell laid out as the renderer's texture
+      mode (columns across, rows up), and each step draws one into the other through a
+      framebuffer with life.fs, the board's rule and wrapping passed as uniforms
+    - the renderer can draw the current texture directly, so the cells never leave the GPU
+    - the engine's board is only brought up to date by gpuSimulation_read
+    - everything is GL 3.3 core, the board must fit in a texture
+*/
+typedef struct {
+    int x;
+    int y;
+    long long generation; // of the current texture
+
+    GLuint program;
+    GLuint VAO;
+    GLuint textures[2];
+    GLuint framebuffers[2]; // each drawing into the texture of the same index
+    int current;            // texture holding the latest generation
+} gpuSimulation;
+
+// GL thread: upload the board, returns -1 if it does not fit in a texture or the shader could not be built
+int gpuSimulation_init(gpuSimulation* g, conway* c);
+
+// GL thread: n generations, leaving the framebuffer and viewport as they were
+void gpuSimulation_step(gpuSimulation* g, int n);
+
+// texture holding the latest generation, changes every step
+GLuint gpuSimulation_texture(gpuSimulation* g);
+
+// GL thread: copy the latest generation into the board, which counts as changed everywhere
+void gpuSimulation_read(gpuSimulation* g, conway* c);
+
+void gpuSimulation_destroy(gpuSimulation* g);
+
+#endif // GPUSIMULATION_H
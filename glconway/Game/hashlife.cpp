@@ -0,0 +1,592 @@
+#include "hashlife.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define HASHLIFE_BLOCK 65536
+
+struct hashlifeArena
+{
+    std::vector<hashlifeNode*> blocks;
+    size_t used; // nodes used in the last block
+};
+
+// arena of the pool thread running this, threads outside the pool share the last one
+static hashlifeArena *hashlife_arena(hashlife *h)
+{
+    return h->arenas[threadPool_index(&h->pool)];
+}
+
+static hashlifeNode *hashlife_alloc(hashlife *h)
+{
+    hashlifeArena *a = hashlife_arena(h);
+    if (a->used == HASHLIFE_BLOCK)
+    {
+        a->blocks.push_back(new hashlifeNode[HASHLIFE_BLOCK]);
+        a->used = 0;
+    }
+
+    return a->blocks.back() + a->used++;
+}
+
+// give back the node this thread allocated last
+static void hashlife_unalloc(hashlife *h)
+{
+    hashlife_arena(h)->used--;
+}
+
+// call fn on every node in the table (not thread safe)
+template <typename F>
+static void hashlife_forEach(hashlife *h, F fn)
+{
+    for (hashlifeArena *a : h->arenas)
+    {
+        for (size_t b = 0; b < a->blocks.size(); b++)
+        {
+            size_t n = b + 1 == a->blocks.size() ? a->used : HASHLIFE_BLOCK;
+            for (size_t i = 0; i < n; i++)
+            {
+                fn(a->blocks[b] + i);
+            }
+        }
+    }
+}
+
+static size_t hashlife_hash(hashlifeNode *nw, hashlifeNode *ne, hashlifeNode *sw, hashlifeNode *se)
+{
+    uint64_t x = (uint64_t)(uintptr_t)nw;
+    x = x * 0x9E3779B97F4A7C15ULL + (uint64_t)(uintptr_t)ne;
+    x = x * 0x9E3779B97F4A7C15ULL + (uint64_t)(uintptr_t)sw;
+    x = x * 0x9E3779B97F4A7C15ULL + (uint64_t)(uintptr_t)se;
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 29;
+    return (size_t)x;
+}
+
+hashlifeNode *hashlife_node(hashlife *h, hashlifeNode *nw, hashlifeNode *ne, hashlifeNode *sw, hashlifeNode *se)
+{
+    std::atomic<hashlifeNode*> *bucket = h->buckets + (hashlife_hash(nw, ne, sw, se) & h->mask);
+
+    hashlifeNode *head = bucket->load(std::memory_order_acquire);
+    hashlifeNode *searched = NULL; // chain from here on was already searched
+    hashlifeNode *n = NULL;
+
+    while (true)
+    {
+        for (hashlifeNode *it = head; it != searched; it = it->next)
+        {
+            if (it->nw == nw && it->ne == ne && it->sw == sw && it->se == se)
+            {
+                if (n)
+                {
+                    // another thread inserted it first
+                    hashlife_unalloc(h);
+                }
+                return it;
+            }
+        }
+
+        if (!n)
+        {
+            n = hashlife_alloc(h);
+            n->level = nw->level + 1;
+            n->population = nw->population + ne->population + sw->population + se->population;
+            n->nw = nw;
+            n->ne = ne;
+            n->sw = sw;
+            n->se = se;
+            n->result.store(NULL, std::memory_order_relaxed);
+        }
+
+        // publish at the head of the chain, on failure only the new entries need searching
+        n->next = head;
+        searched = head;
+        if (bucket->compare_exchange_weak(head, n, std::memory_order_release, std::memory_order_acquire))
+        {
+            return n;
+        }
+    }
+}
+
+void hashlife_init(hashlife *h, int nThreads, int tableLog2)
+{
+    if (tableLog2 <= 0)
+    {
+        tableLog2 = 20;
+    }
+
+    h->mask = ((size_t)1 << tableLog2) - 1;
+    h->buckets = new std::atomic<hashlifeNode*>[h->mask + 1];
+    for (size_t i = 0; i <= h->mask; i++)
+    {
+        h->buckets[i].store(NULL, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        h->leaves[i].level = 0;
+        h->leaves[i].population = i;
+        h->leaves[i].nw = h->leaves[i].ne = h->leaves[i].sw = h->leaves[i].se = NULL;
+        h->leaves[i].result.store(NULL);
+        h->leaves[i].next = NULL;
+    }
+
+    threadPool_init(&h->pool, nThreads);
+
+    h->arenas.resize(h->pool.nThreads);
+    for (hashlifeArena *&a : h->arenas)
+    {
+        a = new hashlifeArena;
+        a->used = HASHLIFE_BLOCK;
+    }
+
+    h->empty[0] = h->leaves;
+    for (int i = 1; i < 63; i++)
+    {
+        h->empty[i] = hashlife_node(h, h->empty[i - 1], h->empty[i - 1], h->empty[i - 1], h->empty[i - 1]);
+    }
+
+    h->birth = 1 << 3;
+    h->survive = (1 << 2) | (1 << 3);
+
+    h->parallelLevel = 9;
+
+    h->step = 0;
+    h->root = h->empty[3];
+    h->originX = -4;
+    h->originY = -4;
+    h->generation = 0;
+}
+
+/*
+    Quadtree helpers
+*/
+
+// center square one level down
+static hashlifeNode *hashlife_center(hashlife *h, hashlifeNode *n)
+{
+    return hashlife_node(h, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+// square straddling the border of two horizontally adjacent nodes
+static hashlifeNode *hashlife_centerH(hashlife *h, hashlifeNode *w, hashlifeNode *e)
+{
+    return hashlife_node(h, w->ne, e->nw, w->se, e->sw);
+}
+
+// square straddling the border of two vertically adjacent nodes
+static hashlifeNode *hashlife_centerV(hashlife *h, hashlifeNode *n, hashlifeNode *s)
+{
+    return hashlife_node(h, n->sw, n->se, s->nw, s->ne);
+}
+
+// true if all live cells are in the center half of the node
+static bool hashlife_padded(hashlifeNode *n)
+{
+    return n->nw->population == n->nw->se->population &&
+        n->ne->population == n->ne->sw->population &&
+        n->sw->population == n->sw->ne->population &&
+        n->se->population == n->se->nw->population;
+}
+
+// same pattern, one level up, centered
+static hashlifeNode *hashlife_expand(hashlife *h, hashlifeNode *n)
+{
+    hashlifeNode *e = h->empty[n->level - 1];
+    return hashlife_node(h,
+        hashlife_node(h, e, e, e, n->nw),
+        hashlife_node(h, e, e, n->ne, e),
+        hashlife_node(h, e, n->sw, e, e),
+        hashlife_node(h, n->se, e, e, e));
+}
+
+/*
+    Result computation
+*/
+
+static int hashlife_rule(hashlife *h, int alive, int neighbors)
+{
+    return ((alive ? h->survive : h->birth) >> neighbors) & 1;
+}
+
+// 4x4 node: center 2x2 one generation later
+static hashlifeNode *hashlife_base(hashlife *h, hashlifeNode *n)
+{
+    hashlifeNode *quads[4] = { n->nw, n->ne, n->sw, n->se };
+    int grid[4][4];
+    for (int q = 0; q < 4; q++)
+    {
+        int x = (q >> 1) * 2;
+        int y = (q & 1) * 2;
+        grid[x][y] = (int)quads[q]->nw->population;
+        grid[x][y + 1] = (int)quads[q]->ne->population;
+        grid[x + 1][y] = (int)quads[q]->sw->population;
+        grid[x + 1][y + 1] = (int)quads[q]->se->population;
+    }
+
+    hashlifeNode *out[4];
+    for (int i = 0; i < 4; i++)
+    {
+        int x = 1 + (i >> 1);
+        int y = 1 + (i & 1);
+
+        int neighbors = 0;
+        for (int xi = -1; xi <= 1; xi++)
+        {
+            for (int yi = -1; yi <= 1; yi++)
+            {
+                if (xi || yi)
+                {
+                    neighbors += grid[x + xi][y + yi];
+                }
+            }
+        }
+
+        out[i] = h->leaves + hashlife_rule(h, grid[x][y], neighbors);
+    }
+
+    return hashlife_node(h, out[0], out[1], out[2], out[3]);
+}
+
+// run fn(i) for i in [0, count), as pool tasks for large nodes
+template <typename F>
+static void hashlife_each(hashlife *h, int level, int count, F fn)
+{
+    if (level < h->parallelLevel)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            fn(i);
+        }
+        return;
+    }
+
+    threadPoolGroup group;
+    group.pending.store(0);
+    for (int i = 1; i < count; i++)
+    {
+        threadPool_spawn(&h->pool, &group, [&fn, i] {
+            fn(i);
+        });
+    }
+
+    // do one ourselves rather than wait
+    fn(0);
+    threadPool_wait(&h->pool, &group);
+}
+
+static hashlifeNode *hashlife_result(hashlife *h, hashlifeNode *n)
+{
+    hashlifeNode *r = n->result.load(std::memory_order_acquire);
+    if (r)
+    {
+        return r;
+    }
+
+    if (n->population == 0)
+    {
+        r = h->empty[n->level - 1];
+    }
+    else if (n->level == 2)
+    {
+        r = hashlife_base(h, n);
+    }
+    else
+    {
+        // nine overlapping squares one level down
+        hashlifeNode *sub[9] = {
+            n->nw, hashlife_centerH(h, n->nw, n->ne), n->ne,
+            hashlife_centerV(h, n->nw, n->sw), hashlife_center(h, n), hashlife_centerV(h, n->ne, n->se),
+            n->sw, hashlife_centerH(h, n->sw, n->se), n->se
+        };
+
+        // full speed advances both halves, otherwise only the second
+        hashlifeNode *mid[9];
+        if (h->step >= n->level - 2)
+        {
+            hashlife_each(h, n->level, 9, [h, &sub, &mid](int i) {
+                mid[i] = hashlife_result(h, sub[i]);
+            });
+        }
+        else
+        {
+            for (int i = 0; i < 9; i++)
+            {
+                mid[i] = hashlife_center(h, sub[i]);
+            }
+        }
+
+        hashlifeNode *quads[4] = {
+            hashlife_node(h, mid[0], mid[1], mid[3], mid[4]),
+            hashlife_node(h, mid[1], mid[2], mid[4], mid[5]),
+            hashlife_node(h, mid[3], mid[4], mid[6], mid[7]),
+            hashlife_node(h, mid[4], mid[5], mid[7], mid[8])
+        };
+
+        hashlifeNode *out[4];
+        hashlife_each(h, n->level, 4, [h, &quads, &out](int i) {
+            out[i] = hashlife_result(h, quads[i]);
+        });
+
+        r = hashlife_node(h, out[0], out[1], out[2], out[3]);
+    }
+
+    n->result.store(r, std::memory_order_release);
+    return r;
+}
+
+/*
+    Table maintenance (between steps only)
+*/
+
+static void hashlife_clearResults(hashlife *h)
+{
+    hashlife_forEach(h, [](hashlifeNode *n) {
+        n->result.store(NULL, std::memory_order_relaxed);
+    });
+    for (int i = 0; i < 2; i++)
+    {
+        h->leaves[i].result.store(NULL, std::memory_order_relaxed);
+    }
+}
+
+static void hashlife_setStep(hashlife *h, int step)
+{
+    if (h->step != step)
+    {
+        // memoized results are only valid for one step size
+        h->step = step;
+        hashlife_clearResults(h);
+    }
+}
+
+// keep chains short by doubling the bucket count when the table gets full
+static void hashlife_grow(hashlife *h)
+{
+    size_t count = (size_t)hashlife_nodeCount(h);
+    if (count <= 2 * (h->mask + 1))
+    {
+        return;
+    }
+
+    size_t size = h->mask + 1;
+    while (count > size)
+    {
+        size <<= 1;
+    }
+
+    delete[] h->buckets;
+    h->mask = size - 1;
+    h->buckets = new std::atomic<hashlifeNode*>[size];
+    for (size_t i = 0; i < size; i++)
+    {
+        h->buckets[i].store(NULL, std::memory_order_relaxed);
+    }
+
+    hashlife_forEach(h, [h](hashlifeNode *n) {
+        std::atomic<hashlifeNode*> *bucket = h->buckets + (hashlife_hash(n->nw, n->ne, n->sw, n->se) & h->mask);
+        n->next = bucket->load(std::memory_order_relaxed);
+        bucket->store(n, std::memory_order_relaxed);
+    });
+}
+
+// advance the root by 2^step generations
+static void hashlife_stepLog2(hashlife *h, int step)
+{
+    hashlife_grow(h);
+    hashlife_setStep(h, step);
+
+    // pad so nothing can escape the result square
+    while (h->root->level < step + 2 || !hashlife_padded(h->root))
+    {
+        h->originX -= 1LL << (h->root->level - 1);
+        h->originY -= 1LL << (h->root->level - 1);
+        h->root = hashlife_expand(h, h->root);
+    }
+
+    // the result of the expanded root covers the same square as the root
+    hashlifeNode *outer = hashlife_expand(h, h->root);
+    h->root = hashlife_result(h, outer);
+    h->generation += 1LL << step;
+
+    // drop empty borders
+    while (h->root->level > 3 && hashlife_padded(h->root))
+    {
+        h->originX += 1LL << (h->root->level - 2);
+        h->originY += 1LL << (h->root->level - 2);
+        h->root = hashlife_center(h, h->root);
+    }
+}
+
+void hashlife_simulateN(hashlife *h, long long n)
+{
+    for (int step = 0; n > 0; step++, n >>= 1)
+    {
+        if (n & 1)
+        {
+            hashlife_stepLog2(h, step);
+        }
+    }
+}
+
+/*
+    Conversion to and from the flat board
+*/
+
+static hashlifeNode *hashlife_build(hashlife *h, conway *c, int level, long long x, long long y)
+{
+    long long size = 1LL << level;
+    if (x >= c->x || y >= c->y || x + size <= 0 || y + size <= 0)
+    {
+        return h->empty[level];
+    }
+
+    if (level == 0)
+    {
+        return h->leaves + (c->board[x * c->y + y] ? 1 : 0);
+    }
+
+    // skip empty 8x8 blocks a row at a time
+    if (level == 3 && x >= 0 && y >= 0 && x + 8 <= c->x && y + 8 <= c->y)
+    {
+        uint64_t any = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            uint64_t row;
+            memcpy(&row, c->board + (x + i) * c->y + y, 8);
+            any |= row;
+        }
+
+        if (!any)
+        {
+            return h->empty[3];
+        }
+    }
+
+    long long half = size >> 1;
+    hashlifeNode *quads[4];
+    hashlife_each(h, level, 4, [h, c, level, x, y, half, &quads](int i) {
+        quads[i] = hashlife_build(h, c, level - 1, x + (i >> 1) * half, y + (i & 1) * half);
+    });
+
+    return hashlife_node(h, quads[0], quads[1], quads[2], quads[3]);
+}
+
+static void hashlife_write(hashlife *h, conway *c, hashlifeNode *n, long long x, long long y)
+{
+    long long size = 1LL << n->level;
+    if (n->population == 0 || x >= c->x || y >= c->y || x + size <= 0 || y + size <= 0)
+    {
+        return;
+    }
+
+    if (n->level == 0)
+    {
+        c->board[x * c->y + y] = 1;
+        return;
+    }
+
+    long long half = size >> 1;
+    hashlifeNode *quads[4] = { n->nw, n->ne, n->sw, n->se };
+    hashlife_each(h, n->level, 4, [h, c, x, y, half, &quads](int i) {
+        hashlife_write(h, c, quads[i], x + (i >> 1) * half, y + (i & 1) * half);
+    });
+}
+
+int hashlife_import(hashlife *h, conway *c)
+{
+    return hashlife_importWindow(h, c, 0, 0);
+}
+
+// write the part of the universe covered by the board, anything outside is dropped
+void hashlife_export(hashlife *h, conway *c)
+{
+    hashlife_exportWindow(h, c, 0, 0);
+}
+
+int hashlife_importWindow(hashlife *h, conway *c, long long x, long long y)
+{
+    if (hashlife_setRule(h, c->birth, c->survive))
+    {
+        return -1;
+    }
+
+    // root stays centered on (0, 0), big enough to hold the window
+    int level = 3;
+    while (x < -(1LL << (level - 1)) || x + c->x > (1LL << (level - 1)) ||
+        y < -(1LL << (level - 1)) || y + c->y > (1LL << (level - 1)))
+    {
+        level++;
+    }
+
+    h->originX = -(1LL << (level - 1));
+    h->originY = -(1LL << (level - 1));
+    h->root = hashlife_build(h, c, level, h->originX - x, h->originY - y);
+    h->generation = c->generation;
+    return 0;
+}
+
+void hashlife_exportWindow(hashlife *h, conway *c, long long x, long long y)
+{
+    memset(c->board, 0, (size_t)c->x * c->y);
+    hashlife_write(h, c, h->root, h->originX - x, h->originY - y);
+    c->generation = h->generation;
+    conway_markAllChanged(c);
+}
+
+int hashlife_setRule(hashlife *h, unsigned short birth, unsigned short survive)
+{
+    // empty space would come alive, which the empty nodes can't represent
+    if (birth & 1)
+    {
+        return -1;
+    }
+
+    // results memoized under another rule are stale
+    if (h->birth != birth || h->survive != survive)
+    {
+        h->birth = birth;
+        h->survive = survive;
+        hashlife_clearResults(h);
+    }
+    return 0;
+}
+
+long long hashlife_population(hashlife *h)
+{
+    return h->root->population;
+}
+
+long long hashlife_nodeCount(hashlife *h)
+{
+    long long count = 0;
+    for (hashlifeArena *a : h->arenas)
+    {
+        if (!a->blocks.empty())
+        {
+            count += (long long)(a->blocks.size() - 1) * HASHLIFE_BLOCK + a->used;
+        }
+    }
+
+    return count;
+}
+
+void hashlife_destroy(hashlife *h)
+{
+    threadPool_destroy(&h->pool);
+
+    for (hashlifeArena *a : h->arenas)
+    {
+        for (hashlifeNode *block : a->blocks)
+        {
+            delete[] block;
+        }
+        delete a;
+    }
+    h->arenas.clear();
+
+    delete[] h->buckets;
+    h->buckets = NULL;
+    h->root = NULL;
+}
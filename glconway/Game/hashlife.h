@@ -0,0 +1,92 @@
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "conway.h"
+#include "threadPool.h"
+
+/*
+    quadtree node, shared by every place the same square appears
+    - level 0 is a single cell, level k covers 2^k x 2^k cells
+    - quadrants are nw, ne, sw, se with rows growing downward (same as the board)
+*/
+typedef struct hashlifeNode
+{
+    int level;
+    long long population;
+
+    struct hashlifeNode *nw;
+    struct hashlifeNode *ne;
+    struct hashlifeNode *sw;
+    struct hashlifeNode *se;
+
+    // center 2^(level - 1) square, 2^min(step, level - 2) generations later
+    std::atomic<struct hashlifeNode*> result;
+
+    // next node in the same hash bucket
+    struct hashlifeNode *next;
+} hashlifeNode;
+
+typedef struct hashlifeArena hashlifeArena;
+
+/*
+    multithreaded hashlife universe
+    - nodes are hash-consed in a concurrent table (lock-free inserts into bucket chains)
+    - results of large nodes are computed as sub-quadrant tasks on a work-stealing pool
+    - the universe is an unbounded plane, the wrap flag of imported boards is ignored
+    - the rule comes from the imported board, rules with B0 are not supported
+    - nodes are only freed by hashlife_destroy
+    - one thread at a time may call in from outside the pool
+*/
+typedef struct
+{
+    std::atomic<hashlifeNode*> *buckets;
+    size_t mask;
+
+    // node storage, one arena per pool thread
+    std::vector<hashlifeArena*> arenas;
+
+    hashlifeNode leaves[2];
+    hashlifeNode *empty[63];
+
+    unsigned short birth;
+    unsigned short survive;
+
+    threadPool pool;
+    int parallelLevel; // nodes at or above this level split their work into tasks
+
+    int step; // log2 of the generations results are currently memoized for
+
+    // always centered on universe cell (0, 0)
+    hashlifeNode *root;
+    long long originX; // universe coordinates of the root's top left cell
+    long long originY;
+    long long generation;
+} hashlife;
+
+void hashlife_init(hashlife *h, int nThreads, int tableLog2);
+
+// returns -1 if the board's rule has B0
+int hashlife_import(hashlife *h, conway *c);
+void hashlife_export(hashlife *h, conway *c);
+
+// same, with board cell (0, 0) at universe cell (x, y)
+int hashlife_importWindow(hashlife *h, conway *c, long long x, long long y);
+void hashlife_exportWindow(hashlife *h, conway *c, long long x, long long y);
+
+// returns -1 for rules with B0, keeping the current one
+int hashlife_setRule(hashlife *h, unsigned short birth, unsigned short survive);
+
+hashlifeNode *hashlife_node(hashlife *h, hashlifeNode *nw, hashlifeNode *ne, hashlifeNode *sw, hashlifeNode *se);
+
+void hashlife_simulateN(hashlife *h, long long n);
+
+long long hashlife_population(hashlife *h);
+long long hashlife_nodeCount(hashlife *h);
+
+void hashlife_destroy(hashlife *h);
+
+#endif // HASHLIFE_H
@@ -0,0 +1,309 @@
+#include "history.h"
+#include "compress.h"
+
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string history_segmentPath(history *h, historySegment *s)
+{
+    return h->spillPath + "." + std::to_string(s->id);
+}
+
+void history_init(history *h, conway *c, int keyframeInterval,
+    size_t memoryBudget, size_t diskBudget, const char *spillPath)
+{
+    h->x = c->x;
+    h->y = c->y;
+    h->packedSize = ((size_t)c->x * c->y + 7) / 8;
+
+    h->keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 64;
+    h->memoryBudget = memoryBudget;
+    h->diskBudget = spillPath ? diskBudget : 0;
+    h->spillPath = spillPath ? spillPath : "";
+
+    h->segments.clear();
+    h->nextId = 0;
+    h->memoryUsed = 0;
+    h->diskUsed = 0;
+
+    h->previous = (unsigned char*)malloc(h->packedSize);
+    h->previousGeneration = -1;
+}
+
+// give back a segment's memory or disk space before it is dropped
+static void history_release(history *h, historySegment *s)
+{
+    if (s->spilled)
+    {
+        remove(history_segmentPath(h, s).c_str());
+        h->diskUsed -= s->diskSize;
+    }
+    else
+    {
+        h->memoryUsed -= s->offsets.back();
+    }
+}
+
+static void history_dropOldest(history *h)
+{
+    history_release(h, &h->segments.front());
+    h->segments.pop_front();
+}
+
+// forget generation and everything recorded after it, keeping the segments in order
+static void history_truncate(history *h, long long generation)
+{
+    while (!h->segments.empty() && h->segments.back().generation >= generation)
+    {
+        history_release(h, &h->segments.back());
+        h->segments.pop_back();
+    }
+
+    if (h->segments.empty())
+    {
+        return;
+    }
+
+    historySegment &s = h->segments.back();
+    if (s.generation + s.count > generation)
+    {
+        size_t size = s.offsets.back();
+        s.count = (int)(generation - s.generation);
+        s.offsets.resize(s.count + 1);
+
+        // a spilled file is cut back too, if that fails it keeps its tail (never read) and its disk usage
+        size_t removed = size - s.offsets.back();
+        if (s.spilled)
+        {
+            std::error_code error;
+            std::filesystem::resize_file(history_segmentPath(h, &s), s.offsets.back(), error);
+            if (!error)
+            {
+                h->diskUsed -= removed;
+                s.diskSize = s.offsets.back();
+            }
+        }
+        else
+        {
+            h->memoryUsed -= removed;
+            s.blob.resize(s.offsets.back());
+        }
+    }
+}
+
+// move the oldest in-memory segment to disk, false if there is none besides the one being recorded
+static bool history_spill(history *h)
+{
+    for (size_t i = 0; i + 1 < h->segments.size(); i++)
+    {
+        historySegment &s = h->segments[i];
+        if (s.spilled)
+        {
+            continue;
+        }
+
+        FILE *file = fopen(history_segmentPath(h, &s).c_str(), "wb");
+        if (!file)
+        {
+            return false;
+        }
+        bool ok = fwrite(s.blob.data(), 1, s.blob.size(), file) == s.blob.size();
+        ok = !fclose(file) && ok;
+        if (!ok)
+        {
+            return false;
+        }
+
+        h->memoryUsed -= s.blob.size();
+        h->diskUsed += s.blob.size();
+        s.diskSize = s.blob.size();
+        s.spilled = true;
+        std::vector<unsigned char>().swap(s.blob);
+        return true;
+    }
+
+    return false;
+}
+
+static void history_enforceBudgets(history *h)
+{
+    // the segment being recorded always stays in memory
+    while (h->memoryUsed > h->memoryBudget && h->segments.size() > 1)
+    {
+        if (!h->diskBudget)
+        {
+            history_dropOldest(h);
+        }
+        else if (!history_spill(h))
+        {
+            break;
+        }
+    }
+
+    while (h->diskUsed > h->diskBudget && h->segments.size() > 1)
+    {
+        history_dropOldest(h);
+    }
+}
+
+int history_record(history *h, conway *c)
+{
+    if (c->x != h->x || c->y != h->y)
+    {
+        return -1;
+    }
+
+    // recording an earlier generation again (after a seek) replaces what followed it
+    if (!h->segments.empty() && c->generation <= h->previousGeneration)
+    {
+        history_truncate(h, c->generation);
+    }
+
+    unsigned char *packed = (unsigned char*)malloc(h->packedSize);
+    compress_packBits(c->board, (size_t)h->x * h->y, packed);
+
+    // keyframe at the start of a segment or after a gap, otherwise the change since the last generation
+    bool keyframe = h->segments.empty() ||
+        h->segments.back().count == h->keyframeInterval ||
+        c->generation != h->previousGeneration + 1;
+
+    if (keyframe)
+    {
+        historySegment s;
+        s.generation = c->generation;
+        s.count = 0;
+        s.offsets.push_back(0);
+        s.spilled = false;
+        s.diskSize = 0;
+        s.id = h->nextId++;
+        h->segments.push_back(s);
+    }
+    else
+    {
+        for (size_t i = 0; i < h->packedSize; i++)
+        {
+            h->previous[i] ^= packed[i];
+        }
+    }
+
+    historySegment &s = h->segments.back();
+    const unsigned char *entry = keyframe ? packed : h->previous;
+    size_t start = s.blob.size();
+    s.blob.resize(start + compress_rleBound(h->packedSize));
+    size_t size = compress_rle(entry, h->packedSize, s.blob.data() + start);
+    s.blob.resize(start + size);
+    s.offsets.push_back(start + size);
+    s.count++;
+    h->memoryUsed += size;
+
+    free(h->previous);
+    h->previous = packed;
+    h->previousGeneration = c->generation;
+
+    history_enforceBudgets(h);
+    return 0;
+}
+
+long long history_first(history *h)
+{
+    return h->segments.empty() ? -1 : h->segments.front().generation;
+}
+
+long long history_last(history *h)
+{
+    return h->segments.empty() ? -1 : h->previousGeneration;
+}
+
+int history_seek(history *h, long long generation, conway *c)
+{
+    if (c->x != h->x || c->y != h->y)
+    {
+        return -1;
+    }
+
+    // segments are in generation order
+    size_t lo = 0;
+    size_t hi = h->segments.size();
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (h->segments[mid].generation + h->segments[mid].count <= generation)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (lo == h->segments.size() || h->segments[lo].generation > generation)
+    {
+        return -1;
+    }
+
+    historySegment &s = h->segments[lo];
+    int index = (int)(generation - s.generation);
+
+    // only the entries up to the one wanted are read
+    std::vector<unsigned char> spilled;
+    const unsigned char *blob = s.blob.data();
+    if (s.spilled)
+    {
+        spilled.resize(s.offsets[index + 1]);
+        FILE *file = fopen(history_segmentPath(h, &s).c_str(), "rb");
+        bool ok = file && fread(spilled.data(), 1, spilled.size(), file) == spilled.size();
+        if (file)
+        {
+            fclose(file);
+        }
+        if (!ok)
+        {
+            return -1;
+        }
+        blob = spilled.data();
+    }
+
+    unsigned char *packed = (unsigned char*)malloc(h->packedSize);
+    unsigned char *delta = (unsigned char*)malloc(h->packedSize);
+    int ret = 0;
+
+    for (int i = 0; i <= index && !ret; i++)
+    {
+        unsigned char *out = i ? delta : packed;
+        if (compress_unrle(blob + s.offsets[i], s.offsets[i + 1] - s.offsets[i], out, h->packedSize) != (long long)h->packedSize)
+        {
+            ret = -1;
+        }
+        else if (i)
+        {
+            for (size_t j = 0; j < h->packedSize; j++)
+            {
+                packed[j] ^= delta[j];
+            }
+        }
+    }
+
+    if (!ret)
+    {
+        compress_unpackBits(packed, (size_t)h->x * h->y, c->board);
+        c->generation = generation;
+        conway_markAllChanged(c);
+    }
+
+    free(packed);
+    free(delta);
+    return ret;
+}
+
+void history_destroy(history *h)
+{
+    while (!h->segments.empty())
+    {
+        history_dropOldest(h);
+    }
+
+    free(h->previous);
+    h->previous = NULL;
+}
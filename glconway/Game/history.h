@@ -0,0 +1,69 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <deque>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "conway.h"
+
+/*
+    generation history
+    - recorded generations are grouped in segments: a keyframe, then XOR deltas to the previous generation
+    - keyframes and deltas are bit packed and run length coded (deltas are mostly zeros)
+    - seeking decodes at most one keyframe and keyframeInterval - 1 deltas
+    - over the memory budget the oldest segments move to disk, over the disk budget they are dropped
+*/
+typedef struct
+{
+    long long generation; // of the keyframe
+    int count;
+
+    // entry i is blob[offsets[i], offsets[i + 1])
+    std::vector<size_t> offsets;
+    std::vector<unsigned char> blob;
+
+    bool spilled; // blob moved to its own file
+    size_t diskSize; // bytes of that file
+    int id;
+} historySegment;
+
+typedef struct
+{
+    int x;
+    int y;
+    size_t packedSize;
+
+    int keyframeInterval;
+    size_t memoryBudget;
+    size_t diskBudget; // 0 keeps everything in memory, dropping segments instead
+    std::string spillPath;
+
+    std::deque<historySegment> segments;
+    int nextId;
+    size_t memoryUsed;
+    size_t diskUsed;
+
+    // last recorded generation, packed
+    unsigned char *previous;
+    long long previousGeneration;
+} history;
+
+void history_init(history *h, conway *c, int keyframeInterval,
+    size_t memoryBudget, size_t diskBudget, const char *spillPath);
+
+// record the board's current generation, dropping anything recorded from it on,
+// returns -1 if the board's dimensions differ from the history's
+int history_record(history *h, conway *c);
+
+// oldest and newest recorded generations, -1 if nothing is recorded
+long long history_first(history *h);
+long long history_last(history *h);
+
+// write a recorded generation into c (same dimensions), returns -1 if it isn't recorded
+int history_seek(history *h, long long generation, conway *c);
+
+void history_destroy(history *h);
+
+#endif // HISTORY_H
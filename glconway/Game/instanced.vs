@@ -0,0 +1,21 @@
+#version 330 core
+
+// one instance per live cell: its row and column
+layout (location = 0) in ivec2 cell;
+
+uniform float cellWidth;
+uniform float cellHeight;
+// board column and row at the bottom left of the screen
+uniform vec2 origin;
+
+void main() {
+	// corners of the cell's quad as a triangle strip, from the vertex index alone
+	vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+
+	gl_Position = vec4(
+		(float(cell.y) + corner.x - origin.x) * cellWidth - 1.0,
+		(float(cell.x) + corner.y - origin.y) * cellHeight - 1.0,
+		0.0,
+		1.0
+	);
+}
@@ -0,0 +1,40 @@
+#version 330 core
+
+// one texel per cell, columns along x and rows along y
+uniform usampler2D board;
+
+// cells off the edge are the opposite edge's when wrapping, dead otherwise
+uniform bool wrap;
+
+// rule as neighbor count bitmasks
+uniform int birth;
+uniform int survive;
+
+out uint next;
+
+uint cell(ivec2 at, ivec2 size) {
+	if (wrap) {
+		at = (at + size) % size;
+	}
+	else if (any(lessThan(at, ivec2(0))) || any(greaterThanEqual(at, size))) {
+		return 0u;
+	}
+	return texelFetch(board, at, 0).r;
+}
+
+void main() {
+	ivec2 size = textureSize(board, 0);
+	ivec2 at = ivec2(gl_FragCoord.xy);
+
+	int neighbors = 0;
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			if (dx != 0 || dy != 0) {
+				neighbors += int(cell(at + ivec2(dx, dy), size));
+			}
+		}
+	}
+
+	int rule = texelFetch(board, at, 0).r != 0u ? survive : birth;
+	next = uint((rule >> neighbors) & 1);
+}
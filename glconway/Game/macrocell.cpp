@@ -0,0 +1,260 @@
+#include "macrocell.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#define MACROCELL_LINE 1024
+
+// 8x8 leaf from rows of '.' and '*' separated by '$'
+static hashlifeNode *macrocell_leaf(hashlife *h, const char *line)
+{
+    char cells[8][8];
+    memset(cells, 0, sizeof(cells));
+
+    int x = 0;
+    int y = 0;
+    for (const char *p = line; *p && x < 8; p++)
+    {
+        if (*p == '$')
+        {
+            x++;
+            y = 0;
+        }
+        else if (y < 8)
+        {
+            cells[x][y++] = *p == '*';
+        }
+    }
+
+    // build up 2x2, 4x4, 8x8
+    hashlifeNode *level1[4][4];
+    for (x = 0; x < 4; x++)
+    {
+        for (y = 0; y < 4; y++)
+        {
+            level1[x][y] = hashlife_node(h,
+                h->leaves + cells[2 * x][2 * y], h->leaves + cells[2 * x][2 * y + 1],
+                h->leaves + cells[2 * x + 1][2 * y], h->leaves + cells[2 * x + 1][2 * y + 1]);
+        }
+    }
+
+    hashlifeNode *level2[2][2];
+    for (x = 0; x < 2; x++)
+    {
+        for (y = 0; y < 2; y++)
+        {
+            level2[x][y] = hashlife_node(h,
+                level1[2 * x][2 * y], level1[2 * x][2 * y + 1],
+                level1[2 * x + 1][2 * y], level1[2 * x + 1][2 * y + 1]);
+        }
+    }
+
+    return hashlife_node(h, level2[0][0], level2[0][1], level2[1][0], level2[1][1]);
+}
+
+int macrocell_load(hashlife *h, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    // node i of the file, 0 stands for an empty node
+    std::vector<hashlifeNode*> nodes(1, (hashlifeNode*)NULL);
+    long long generation = 0;
+
+    // B3/S23 unless the file has a #R line
+    conway rule;
+    conway_setRule(&rule, "B3/S23");
+
+    char line[MACROCELL_LINE];
+    int ret = 0;
+    while (!ret && fgets(line, sizeof(line), file))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (line[0] == '[' || line[0] == '\0')
+        {
+            continue;
+        }
+        else if (line[0] == '#')
+        {
+            if (line[1] == 'R')
+            {
+                if (conway_setRule(&rule, line + 2 + strspn(line + 2, " ")))
+                {
+                    ret = -1;
+                }
+            }
+            else if (line[1] == 'G')
+            {
+                generation = atoll(line + 2);
+            }
+        }
+        else if (line[0] == '.' || line[0] == '*' || line[0] == '$')
+        {
+            nodes.push_back(macrocell_leaf(h, line));
+        }
+        else
+        {
+            // log2 size, then nw ne sw se
+            int level;
+            long long children[4];
+            if (sscanf(line, "%d %lld %lld %lld %lld", &level,
+                children, children + 1, children + 2, children + 3) != 5 ||
+                level < 4 || level > 62)
+            {
+                ret = -1;
+                break;
+            }
+
+            hashlifeNode *quads[4];
+            for (int i = 0; i < 4; i++)
+            {
+                if (children[i] < 0 || children[i] >= (long long)nodes.size() ||
+                    (children[i] && nodes[children[i]]->level != level - 1))
+                {
+                    ret = -1;
+                    break;
+                }
+                quads[i] = children[i] ? nodes[children[i]] : h->empty[level - 1];
+            }
+
+            if (!ret)
+            {
+                nodes.push_back(hashlife_node(h, quads[0], quads[1], quads[2], quads[3]));
+            }
+        }
+    }
+    fclose(file);
+
+    if (ret || nodes.size() < 2 || hashlife_setRule(h, rule.birth, rule.survive))
+    {
+        return -1;
+    }
+
+    // the last node is the root
+    h->root = nodes.back();
+    h->originX = -(1LL << (h->root->level - 1));
+    h->originY = -(1LL << (h->root->level - 1));
+    h->generation = generation;
+
+    return 0;
+}
+
+typedef struct
+{
+    FILE *file;
+    std::unordered_map<hashlifeNode*, long long> index;
+    long long count;
+} macrocellWriter;
+
+// write children before parents, returns the node's index (0 if empty)
+static long long macrocell_write(macrocellWriter *w, hashlifeNode *n)
+{
+    if (n->population == 0)
+    {
+        return 0;
+    }
+
+    auto found = w->index.find(n);
+    if (found != w->index.end())
+    {
+        return found->second;
+    }
+
+    if (n->level == 3)
+    {
+        hashlifeNode *level2[4] = { n->nw, n->ne, n->sw, n->se };
+        char cells[8][8];
+        for (int q = 0; q < 4; q++)
+        {
+            hashlifeNode *level1[4] = { level2[q]->nw, level2[q]->ne, level2[q]->sw, level2[q]->se };
+            for (int i = 0; i < 4; i++)
+            {
+                int x = (q >> 1) * 4 + (i >> 1) * 2;
+                int y = (q & 1) * 4 + (i & 1) * 2;
+                cells[x][y] = (char)level1[i]->nw->population;
+                cells[x][y + 1] = (char)level1[i]->ne->population;
+                cells[x + 1][y] = (char)level1[i]->sw->population;
+                cells[x + 1][y + 1] = (char)level1[i]->se->population;
+            }
+        }
+
+        // rows without trailing dead cells, trailing empty rows dropped
+        char line[8 * 9 + 2];
+        int len = 0;
+        int lastRow = 0;
+        for (int x = 0; x < 8; x++)
+        {
+            int end = 8;
+            while (end > 0 && !cells[x][end - 1])
+            {
+                end--;
+            }
+            for (int y = 0; y < end; y++)
+            {
+                line[len++] = cells[x][y] ? '*' : '.';
+            }
+            line[len++] = '$';
+            if (end)
+            {
+                lastRow = len;
+            }
+        }
+        line[lastRow] = '\0';
+
+        fprintf(w->file, "%s\n", line);
+    }
+    else
+    {
+        long long nw = macrocell_write(w, n->nw);
+        long long ne = macrocell_write(w, n->ne);
+        long long sw = macrocell_write(w, n->sw);
+        long long se = macrocell_write(w, n->se);
+        fprintf(w->file, "%d %lld %lld %lld %lld\n", n->level, nw, ne, sw, se);
+    }
+
+    w->index[n] = ++w->count;
+    return w->count;
+}
+
+int macrocell_save(hashlife *h, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return -1;
+    }
+
+    conway rule;
+    rule.birth = h->birth;
+    rule.survive = h->survive;
+    char ruleString[32];
+    conway_ruleString(&rule, ruleString);
+
+    fprintf(file, "[M2] (glconway)\n#R %s\n", ruleString);
+    if (h->generation)
+    {
+        fprintf(file, "#G %lld\n", h->generation);
+    }
+
+    macrocellWriter w;
+    w.file = file;
+    w.count = 0;
+    if (h->root->population == 0)
+    {
+        // an empty universe still needs a root
+        fprintf(file, "4 0 0 0 0\n");
+    }
+    else
+    {
+        macrocell_write(&w, h->root);
+    }
+
+    return fclose(file) ? -1 : 0;
+}
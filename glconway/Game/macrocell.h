@@ -0,0 +1,16 @@
+#ifndef MACROCELL_H
+#define MACROCELL_H
+
+#include "hashlife.h"
+
+/*
+    macrocell (.mc) patterns
+    - nodes are read straight into the hashlife table, shared subtrees stay shared
+    - the root is centered on universe cell (0, 0), use hashlife_exportWindow for a flat view
+    - functions return 0 on success, -1 on error
+*/
+
+int macrocell_load(hashlife *h, const char *path);
+int macrocell_save(hashlife *h, const char *path);
+
+#endif // MACROCELL_H
@@ -1,30 +1,50 @@
 #include <iostream>
+#include <stdio.h>
 #include <stdlib.h>
-#include <sstream>
-#include <fstream>
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "conway.h"
-
-void printTable(char** table, int n)
-{
-    for (int i = 0; i < n; i++)
-    {
-        printf("%s\n", table[i]);
-    }
-
-    printf("\n\n");
-}
+#include "rle.h"
+#include "terminal.h"
+#include "frameExport.h"
+#include "dump.h"
+#include "pattern.h"
+#include "renderer.h"
+#include "offscreen.h"
+#include "profiler.h"
+#include "gpuSimulation.h"
 
 // rendering parameters
 const char* title = "Conway's Game of Life";
 unsigned int width = 100;
 unsigned int height = 30;
 unsigned int cellDim = 20;
-
-double generationFrequency = 0.025; // time in between generations
+unsigned int maxWindowWidth = 1280; // larger boards start zoomed out
+unsigned int maxWindowHeight = 720;
+double zoomStep = 1.25; // per scroll notch
+
+double generationFrequency = 0.025; // time in between generations, 0 to run as fast as possible
+long long maxCatchUp = 64; // generations run at once when behind, the rest of the backlog is dropped
+double publishFrequency = 1.0 / 240.0; // time in between frames handed over when running as fast as possible
+double statsFrequency = 0.5; // time in between title updates
+double terminalFps = 30.0; // terminal redraw limit, 0 to draw every generation
+rendererMode renderMode = RENDERER_INSTANCED;
+int uploadSlots = 3; // frames in flight between the simulation and the GPU
+bool showProfiler = true; // timing overlay, toggled with P
+double profilerMsWidth = 1000.0 / 60.0; // overlay bar length, one frame at 60 Hz
+const char* profileLog = NULL; // CSV of every timed phase, NULL for none
+bool gpuSimulate = false; // step generations in a fragment shader rather than on the simulation thread
+const char* dumpPath = NULL; // every simulated generation written here for offline analysis, NULL for none
+dumpMode dumpRecords = DUMP_DELTA;
 
 // initialize GLFW
 void initGLFW(unsigned int versionMajor, unsigned int versionMinor) {
@@ -55,135 +75,778 @@ void createWindow(GLFWwindow*& window,
 }
 
 /*
-    Shader methods
+    View
 */
 
-std::string readFile(const char* filename) {
-    std::ifstream file;
-    std::stringstream buf;
+typedef struct {
+    renderer* board;
+    rendererView view;
+    int width; // framebuffer
+    int height;
+    double cursorX;
+    double cursorY;
+    bool redraw;
+} viewState;
+
+void setView(viewState* state, rendererView view) {
+    state->view = view;
+    state->redraw = true;
+    renderer_setView(state->board, view, state->width, state->height);
+}
+
+// zoom by factor keeping the cell under (px, py) (from the top left) in place
+void zoomView(viewState* state, double factor, double px, double py) {
+    rendererView view = state->view;
+    double row = view.x + (state->height - py) / view.scale;
+    double col = view.y + px / view.scale;
 
-    std::string ret;
+    view.scale *= factor;
+    view.x = row - (state->height - py) / view.scale;
+    view.y = col - px / view.scale;
+    setView(state, view);
+}
 
-    // open file
-    file.open(filename);
+void panView(viewState* state, double dx, double dy) {
+    rendererView view = state->view;
+    view.x += dy / view.scale;
+    view.y -= dx / view.scale;
+    setView(state, view);
+}
+
+void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
+    glViewport(0, 0, width, height);
 
-    if (file.is_open()) {
-        // read file
-        buf << file.rdbuf();
-        ret = buf.str();
-        file.close();
+    viewState* state = (viewState*)glfwGetWindowUserPointer(window);
+    if (state) {
+        state->width = width;
+        state->height = height;
+        setView(state, state->view);
     }
-    else {
-        std::cout << "Could not read " << filename << std::endl;
+}
+
+void scrollCallback(GLFWwindow* window, double, double dy) {
+    viewState* state = (viewState*)glfwGetWindowUserPointer(window);
+    zoomView(state, pow(zoomStep, dy), state->cursorX, state->cursorY);
+}
+
+void cursorPosCallback(GLFWwindow* window, double x, double y) {
+    viewState* state = (viewState*)glfwGetWindowUserPointer(window);
+
+    // drag to pan
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+        panView(state, x - state->cursorX, y - state->cursorY);
     }
 
-    return ret;
+    state->cursorX = x;
+    state->cursorY = y;
 }
 
-int genShader(const char* filename, GLenum type) {
-    std::string shaderSrc = readFile(filename);
-    const GLchar* shader = shaderSrc.c_str();
-
-    // build and compile
-    int shaderObj = glCreateShader(type);
-    glShaderSource(shaderObj, 1, &shader, NULL);
-    glCompileShader(shaderObj);
-
-    // check for errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(shaderObj, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shaderObj, 512, NULL, infoLog);
-        std::cout << "Error in shader compilation: " << infoLog << std::endl;
-        return -1;
+void keyCallback(GLFWwindow* window, int key, int, int action, int) {
+    if (action == GLFW_RELEASE) {
+        return;
+    }
+
+    viewState* state = (viewState*)glfwGetWindowUserPointer(window);
+    double step = 0.125 * (state->width < state->height ? state->width : state->height);
+    switch (key) {
+    case GLFW_KEY_LEFT: panView(state, step, 0.0); break;
+    case GLFW_KEY_RIGHT: panView(state, -step, 0.0); break;
+    case GLFW_KEY_UP: panView(state, 0.0, step); break;
+    case GLFW_KEY_DOWN: panView(state, 0.0, -step); break;
+    case GLFW_KEY_EQUAL:
+    case GLFW_KEY_KP_ADD: zoomView(state, 2.0, 0.5 * state->width, 0.5 * state->height); break;
+    case GLFW_KEY_MINUS:
+    case GLFW_KEY_KP_SUBTRACT: zoomView(state, 0.5, 0.5 * state->width, 0.5 * state->height); break;
+    case GLFW_KEY_HOME: setView(state, renderer_fitView(state->board, state->width, state->height)); break;
+    case GLFW_KEY_P: showProfiler = !showProfiler; state->redraw = true; break;
     }
+}
 
-    return shaderObj;
+void processInput(GLFWwindow* window) {
+    // close key
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+        glfwSetWindowShouldClose(window, true);
+    }
 }
 
-int genShaderProgram(const char* vertexShaderPath,
-    const char* fragmentShaderPath,
-    const char* geoShaderPath) {
-    int shaderProgram = glCreateProgram();
+/*
+    Simulation thread
+*/
 
-    // compile shaders
-    int vShader = genShader(vertexShaderPath, GL_VERTEX_SHADER);
-    int fShader = genShader(fragmentShaderPath, GL_FRAGMENT_SHADER);
-    int gShader = genShader(geoShaderPath, GL_GEOMETRY_SHADER);
+typedef struct {
+    std::atomic<bool> running;
+    std::atomic<long long> generation; // latest simulated
+    std::atomic<long long> dropped;    // generations given up on to catch up
+} simulation;
 
-    if (vShader == -1 || fShader == -1 || gShader == -1) {
-        return -1;
+/*
+    fixed timestep
+    - elapsed time accumulates, and every generation it covers is run before handing over the latest
+    - when the backlog grows past maxCatchUp the rest is dropped, so a slow engine runs flat out
+      instead of falling further behind
+*/
+void simulationThread(conway* c, renderer* r, terminal* term, simulation* sim, profiler* p, dump* d) {
+    typedef std::chrono::steady_clock clock;
+    std::chrono::duration<double> period(generationFrequency);
+    std::chrono::duration<double> publishPeriod(publishFrequency);
+    std::chrono::duration<double> accumulated(0.0);
+    auto last = clock::now();
+    auto lastPublish = last;
+
+    while (sim->running.load()) {
+        auto now = clock::now();
+        accumulated += now - last;
+        last = now;
+
+        // generations due, one at a time when running flat out
+        long long due = 1;
+        if (generationFrequency > 0.0) {
+            due = (long long)(accumulated / period);
+            accumulated -= (double)due * period;
+        }
+        else {
+            accumulated = accumulated.zero();
+        }
+        if (due > maxCatchUp) {
+            sim->dropped += due - maxCatchUp;
+            due = maxCatchUp;
+        }
+
+        for (long long g = 0; g < due; g++) {
+            profilerTimer t = profiler_start();
+            conway_simulate(c);
+            profiler_stop(p, PROFILER_SIMULATE, t);
+
+            // every generation goes to the dump, blocking here when the disk falls behind
+            if (d) {
+                t = profiler_start();
+                if (dump_push(d, c)) {
+                    // the failure is reported when the dump is closed
+                    d = NULL;
+                }
+                profiler_stop(p, PROFILER_DUMP, t);
+            }
+        }
+
+        if (due) {
+            sim->generation.store(c->generation);
+            profilerTimer t = profiler_start();
+            if (terminal_render(term, c) == 1) {
+                profiler_stop(p, PROFILER_TERMINAL, t);
+            }
+        }
+
+        // hand off the latest to the render thread, straight into GPU memory; a frame dropped for
+        // want of a free slot is pushed again, at most every publish period, until one frees up
+        bool publish = due && (generationFrequency > 0.0 || now - lastPublish >= publishPeriod);
+        bool retry = !due && renderer_ringDropped(r) && now - lastPublish >= publishPeriod;
+        if (publish || retry) {
+            profilerTimer t = profiler_start();
+            renderer_ringPush(r, c);
+            profiler_stop(p, PROFILER_PUSH, t);
+            lastPublish = now;
+        }
+
+        if (generationFrequency > 0.0) {
+            // until the next generation is due, or the next retry of a dropped frame
+            auto wake = now + std::chrono::duration_cast<clock::duration>(period - accumulated);
+            if (renderer_ringDropped(r)) {
+                wake = std::min(wake, now + std::chrono::duration_cast<clock::duration>(publishPeriod));
+            }
+            std::this_thread::sleep_until(wake);
+        }
     }
+}
 
-    // link
-    glAttachShader(shaderProgram, vShader);
-    glAttachShader(shaderProgram, fShader);
-    glAttachShader(shaderProgram, gShader);
-    glLinkProgram(shaderProgram);
+/*
+    GPU simulation
+    - generations are stepped on the GL thread, on the same fixed timestep as the simulation
+      thread (one generation a frame when running flat out), and drawn from the GPU's texture
+    - the board is only read back when the terminal is due a frame
+*/
+typedef struct {
+    double accumulated;
+    double last;
+} gpuTimestep;
+
+// true if any generations were stepped
+bool stepGpu(gpuSimulation* g, conway* c, terminal* term, simulation* sim, profiler* p, gpuTimestep* timestep) {
+    double now = glfwGetTime();
+    long long due = 1;
+    if (generationFrequency > 0.0) {
+        timestep->accumulated += now - timestep->last;
+        due = (long long)(timestep->accumulated / generationFrequency);
+        timestep->accumulated -= (double)due * generationFrequency;
+    }
+    timestep->last = now;
 
-    // check for errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "Error in shader linking: " << infoLog << std::endl;
-        return -1;
+    if (due > maxCatchUp) {
+        sim->dropped += due - maxCatchUp;
+        due = maxCatchUp;
+    }
+    if (!due) {
+        return false;
     }
 
-    glDeleteShader(vShader);
-    glDeleteShader(fShader);
-    glDeleteShader(gShader);
+    profiler_beginQuery(p, PROFILER_GPU_SIMULATE);
+    gpuSimulation_step(g, (int)due);
+    profiler_endQuery(p);
+    sim->generation.store(g->generation);
+
+    if (terminal_due(term)) {
+        profilerTimer t = profiler_start();
+        gpuSimulation_read(g, c);
+        terminal_render(term, c);
+        profiler_stop(p, PROFILER_TERMINAL, t);
+    }
 
-    return shaderProgram;
+    return true;
 }
 
-void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
+// generations and frames per second in the title, the dump's throughput, then the phase timings if shown
+void updateTitle(GLFWwindow* window, long long generation, long long generations, long long frames,
+    double seconds, bool behind, profiler* p, dump* d) {
+    char timings[384] = "";
+    if (showProfiler) {
+        profiler_summary(p, timings, sizeof(timings));
+    }
+
+    char dumped[96] = "";
+    if (d) {
+        dumpStats stats;
+        dump_stats(d, &stats);
+        snprintf(dumped, sizeof(dumped), " - dump %.1f MB/s, queue %d (max %d)",
+            (double)stats.bytes / 1e6 / stats.seconds, stats.queueDepth, stats.maxQueueDepth);
+    }
+
+    char buf[640];
+    snprintf(buf, sizeof(buf), "%s - generation %lld - %.1f gens/s - %.1f fps%s%s%s%s",
+        title, generation, (double)generations / seconds, (double)frames / seconds,
+        behind ? " - behind" : "", dumped, timings[0] ? " - ms p50/p95: " : "", timings);
+    glfwSetWindowTitle(window, buf);
 }
 
-void processInput(GLFWwindow* window) {
-    // close key
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, true);
+// upload the latest frame, timing it when there is one
+bool uploadFrame(renderer* r, profiler* p) {
+    if (!renderer_ringPending(r)) {
+        // still recycles slots
+        return renderer_ringUpload(r);
     }
+
+    profilerTimer t = profiler_start();
+    profiler_beginQuery(p, PROFILER_GPU_UPLOAD);
+    bool uploaded = renderer_ringUpload(r);
+    profiler_endQuery(p);
+    profiler_stop(p, PROFILER_UPLOAD, t);
+    return uploaded;
 }
 
-void renderScreen(GLFWwindow* window, GLuint shaderProgram, conway c, GLuint VAO, GLuint VBO) {
+void renderScreen(GLFWwindow* window, renderer* r, profiler* p, int width, int height) {
     // clear screen
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // update data
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, c.x * c.y, c.board);
-
     // render object
-    glUseProgram(shaderProgram);
-    glDrawArrays(GL_POINTS, 0, c.x * c.y);
+    profilerTimer t = profiler_start();
+    profiler_beginQuery(p, PROFILER_GPU_DRAW);
+    renderer_draw(r);
+    profiler_endQuery(p);
+    profiler_stop(p, PROFILER_DRAW, t);
+
+    if (showProfiler) {
+        profiler_drawOverlay(p, width, height, profilerMsWidth);
+    }
 
     // swap buffers
+    t = profiler_start();
     glfwSwapBuffers(window);
+    profiler_stop(p, PROFILER_SWAP, t);
+
+    // GPU timings from earlier frames
+    profiler_collect(p);
 }
 
-void terminate(conway* c, char **conwayOutput) {
+void terminate(conway* c, terminal* term) {
     // clear conway
     conway_destroy(c);
 
     // terminate GLFW
     glfwTerminate();
 
-    for (int x = 0; x < c->x; x++)
-    {
-        free(conwayOutput[x]);
+    terminal_destroy(term);
+}
+
+/*
+    Headless export
+*/
+
+int exportFrames(const char* pattern, const char* path, long long generations, int scale) {
+    conway c;
+    if (rle_load(&c, pattern, 1)) {
+        std::cerr << "Could not load " << pattern << std::endl;
+        return -1;
+    }
+
+    // format from the extension, anything else is raw grayscale
+    const char* extension = strrchr(path, '.');
+    frameExportFormat format = FRAMEEXPORT_GRAY;
+    if (extension && !strcmp(extension, ".pbm")) {
+        format = FRAMEEXPORT_PBM;
+    }
+    else if (extension && !strcmp(extension, ".png")) {
+        format = FRAMEEXPORT_PNG;
+    }
+    else if (extension && !strcmp(extension, ".y4m")) {
+        format = FRAMEEXPORT_Y4M;
     }
-    free(conwayOutput);
+
+    frameExportSettings settings;
+    frameExport_defaults(&settings, format, path);
+    settings.scale = scale;
+
+    frameExport* frames = frameExport_open(&c, &settings);
+    if (!frames) {
+        std::cerr << "Could not open " << path << std::endl;
+        conway_destroy(&c);
+        return -1;
+    }
+
+    int ret = 0;
+    for (long long g = 0; g <= generations && !ret; g++) {
+        if (g) {
+            conway_simulate(&c);
+        }
+        ret = frameExport_push(frames, &c);
+    }
+
+    ret = frameExport_close(frames) || ret ? -1 : 0;
+    conway_destroy(&c);
+    return ret;
 }
 
-int main()
+/*
+    Headless render benchmark
+*/
+
+// FNV-1a over a frame
+unsigned long long hashPixels(const unsigned char* pixels, size_t size) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ pixels[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// per stage milliseconds over the frames
+typedef struct {
+    double total;
+    double max;
+} stageTime;
+
+void addTime(stageTime* t, std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    double ms = std::chrono::duration<double, std::milli>(to - from).count();
+    t->total += ms;
+    t->max = ms > t->max ? ms : t->max;
+}
+
+/*
+    renders the same generations with every mode into an offscreen framebuffer
+    - the board is a pattern file, or a fixed random soup
+    - upload and draw are each finished (glFinish) before timing the next stage, readback is
+      asynchronous, so its time is what issuing reads and collecting finished ones cost
+    - every mode should give the same pixels at one pixel per cell, frames that differ from the
+      first mode's are counted
+*/
+int benchmarkRender(const char* pattern, long long frames) {
+    const rendererMode modes[] = { RENDERER_POINTS, RENDERER_TEXTURE, RENDERER_PACKED, RENDERER_INSTANCED };
+    const char* modeNames[] = { "points", "texture", "packed", "instanced" };
+
+    conway c;
+    if (pattern ? rle_load(&c, pattern, 1) : (conway_init(&c, 1, 1024, 1024), 0)) {
+        std::cerr << "Could not load " << pattern << std::endl;
+        return -1;
+    }
+    int fboWidth = c.y < (int)maxWindowWidth ? c.y : maxWindowWidth;
+    int fboHeight = c.x < (int)maxWindowHeight ? c.x : maxWindowHeight;
+    conway_destroy(&c);
+
+    offscreen* o = offscreen_open(fboWidth, fboHeight, 3);
+    if (!o) {
+        std::cerr << "Could not create an offscreen context" << std::endl;
+        return -1;
+    }
+
+    std::cout << "mode,frames,upload ms,upload max,draw ms,draw max,readback ms,readback max,fps,differing frames" << std::endl;
+
+    std::vector<unsigned long long> reference;
+    for (int m = 0; m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+        if (pattern) {
+            if (rle_load(&c, pattern, 1)) {
+                std::cerr << "Could not load " << pattern << std::endl;
+                offscreen_close(o);
+                return -1;
+            }
+        }
+        else {
+            conway_init(&c, 1, 1024, 1024);
+            conway_seedRandom(&c, 1.0 / 3.0, 1);
+        }
+        conway_trackDensity(&c);
+
+        offscreen_bind(o);
+        renderer r;
+        if (renderer_init(&r, &c, modes[m])) {
+            std::cerr << "Could not build shaders" << std::endl;
+            conway_destroy(&c);
+            offscreen_close(o);
+            return -1;
+        }
+        renderer_initRing(&r, uploadSlots, offscreen_loader(o));
+
+        // a pixel per cell from the bottom left, where every mode agrees
+        rendererView view = { 0.0, 0.0, 1.0 };
+        renderer_setView(&r, view, fboWidth, fboHeight);
+
+        stageTime upload = { 0.0, 0.0 }, draw = { 0.0, 0.0 }, readback = { 0.0, 0.0 };
+        std::vector<unsigned long long> hashes;
+        size_t frameSize = (size_t)fboWidth * fboHeight * 4;
+
+        auto start = std::chrono::steady_clock::now();
+        for (long long f = 0; f < frames; f++) {
+            if (f) {
+                conway_simulate(&c);
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+            renderer_ringPush(&r, &c);
+            renderer_ringUpload(&r);
+            glFinish();
+
+            auto t1 = std::chrono::steady_clock::now();
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderer_draw(&r);
+            glFinish();
+
+            // only wait for a frame when every pixel buffer is taken
+            auto t2 = std::chrono::steady_clock::now();
+            const unsigned char* pixels;
+            if (offscreen_read(o)) {
+                hashes.push_back(hashPixels(offscreen_collect(o, true), frameSize));
+                offscreen_read(o);
+            }
+            while ((pixels = offscreen_collect(o, false))) {
+                hashes.push_back(hashPixels(pixels, frameSize));
+            }
+            auto t3 = std::chrono::steady_clock::now();
+
+            addTime(&upload, t0, t1);
+            addTime(&draw, t1, t2);
+            addTime(&readback, t2, t3);
+        }
+
+        // frames still in flight
+        const unsigned char* pixels;
+        while ((pixels = offscreen_collect(o, true))) {
+            hashes.push_back(hashPixels(pixels, frameSize));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (reference.empty()) {
+            reference = hashes;
+        }
+        long long differing = 0;
+        for (size_t i = 0; i < hashes.size(); i++) {
+            differing += i >= reference.size() || hashes[i] != reference[i];
+        }
+
+        double n = frames > 0 ? (double)frames : 1.0;
+        printf("%s,%lld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%lld\n", modeNames[m], frames,
+            upload.total / n, upload.max, draw.total / n, draw.max, readback.total / n, readback.max,
+            (double)frames / seconds, differing);
+        fflush(stdout);
+
+        renderer_destroy(&r);
+        conway_destroy(&c);
+    }
+
+    offscreen_close(o);
+    return 0;
+}
+
+/*
+    Headless GPU simulation check
+*/
+
+// the drawn frame for a board or the GPU's texture of it, a cell per pixel from the bottom left
+unsigned long long drawnHash(offscreen* o, renderer* r, GLuint source, int width, int height) {
+    renderer_drawFrom(r, source);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    renderer_draw(r);
+    offscreen_read(o);
+    return hashPixels(offscreen_collect(o, true), (size_t)width * height * 4);
+}
+
+// steps boards on the CPU and the GPU side by side, comparing every generation and the frame drawn
+// from each at the end, returns -1 on any difference
+int checkGpuSimulation(const char* pattern, long long generations) {
+    // the pattern as loaded, or a soup wrapping, not wrapping and under another rule
+    // (an odd number of columns catches row alignment slips)
+    const int soupX = 300;
+    const int soupY = 203;
+    const char wraps[] = { 1, 0, 1 };
+    const char* rules[] = { NULL, NULL, "B36/S23" };
+    int runs = pattern ? 1 : 3;
+
+    int fboWidth = maxWindowWidth;
+    int fboHeight = maxWindowHeight;
+    offscreen* o = offscreen_open(fboWidth, fboHeight, 1);
+    if (!o) {
+        std::cerr << "Could not create an offscreen context" << std::endl;
+        return -1;
+    }
+
+    std::cout << "board,wrap,rule,generations,differing generations,first differing,cpu ms/gen,gpu ms/gen,frames match" << std::endl;
+
+    int ret = 0;
+    for (int run = 0; run < runs; run++) {
+        // stepped on the CPU, and read back into from the GPU
+        conway cpu, readBack;
+        conway* boards[] = { &cpu, &readBack };
+        for (conway* b : boards) {
+            if (pattern) {
+                if (rle_load(b, pattern, 1)) {
+                    std::cerr << "Could not load " << pattern << std::endl;
+                    offscreen_close(o);
+                    return -1;
+                }
+            }
+            else {
+                conway_init(b, wraps[run], soupX, soupY);
+                conway_seedRandom(b, 1.0 / 3.0, run + 1);
+                if (rules[run]) {
+                    conway_setRule(b, rules[run]);
+                }
+            }
+        }
+
+        offscreen_bind(o);
+        gpuSimulation g;
+        if (gpuSimulation_init(&g, &cpu)) {
+            std::cerr << "Could not simulate on the GPU" << std::endl;
+            conway_destroy(&cpu);
+            conway_destroy(&readBack);
+            offscreen_close(o);
+            return -1;
+        }
+
+        stageTime cpuTime = { 0.0, 0.0 }, gpuTime = { 0.0, 0.0 };
+        long long differing = 0;
+        long long first = -1;
+        for (long long gen = 1; gen <= generations; gen++) {
+            auto t0 = std::chrono::steady_clock::now();
+            conway_simulate(&cpu);
+
+            auto t1 = std::chrono::steady_clock::now();
+            gpuSimulation_step(&g, 1);
+            glFinish();
+            addTime(&cpuTime, t0, t1);
+            addTime(&gpuTime, t1, std::chrono::steady_clock::now());
+
+            gpuSimulation_read(&g, &readBack);
+            if (readBack.generation != cpu.generation || memcmp(readBack.board, cpu.board, (size_t)cpu.x * cpu.y)) {
+                differing++;
+                first = first < 0 ? gen : first;
+            }
+        }
+
+        // the renderer drawing the GPU's texture as it would the uploaded board
+        renderer r;
+        bool framesMatch = false;
+        if (renderer_init(&r, &cpu, RENDERER_TEXTURE) == 0 && r.texture) {
+            rendererView view = { 0.0, 0.0, 1.0 };
+            renderer_setView(&r, view, fboWidth, fboHeight);
+            framesMatch = drawnHash(o, &r, 0, fboWidth, fboHeight) ==
+                drawnHash(o, &r, gpuSimulation_texture(&g), fboWidth, fboHeight);
+        }
+        renderer_destroy(&r);
+
+        char rule[64];
+        conway_ruleString(&cpu, rule);
+        double n = generations > 0 ? (double)generations : 1.0;
+        printf("%dx%d,%d,%s,%lld,%lld,%lld,%.3f,%.3f,%s\n", cpu.x, cpu.y, cpu.wrap, rule, generations,
+            differing, first, cpuTime.total / n, gpuTime.total / n, framesMatch ? "yes" : "no");
+        fflush(stdout);
+
+        if (differing || !framesMatch) {
+            ret = -1;
+        }
+
+        gpuSimulation_destroy(&g);
+        conway_destroy(&cpu);
+        conway_destroy(&readBack);
+    }
+
+    offscreen_close(o);
+    return ret;
+}
+
+/*
+    Headless dump check
+*/
+
+// load the pattern, or a soup for the run
+int loadCheckBoard(conway* c, const char* pattern, char wrap, const char* rule, unsigned long long seed) {
+    if (pattern) {
+        return rle_load(c, pattern, 1);
+    }
+
+    conway_init(c, wrap, 300, 203);
+    conway_seedRandom(c, 1.0 / 3.0, seed);
+    if (rule) {
+        conway_setRule(c, rule);
+    }
+    return 0;
+}
+
+// dumps every generation of a board in both record modes, then reads the dump back against the same
+// generations stepped again, returns -1 on any difference
+int checkDump(const char* pattern, long long generations, const char* path) {
+    const char wraps[] = { 1, 0 };
+    const char* rules[] = { NULL, "B36/S23" };
+    const dumpMode modes[] = { DUMP_PACKED, DUMP_DELTA };
+    int runs = pattern ? 1 : 2;
+
+    std::cout << "board,wrap,rule,mode,generations,records,differing,bytes,MB/s,max queue depth,stalled s,writer" << std::endl;
+
+    int ret = 0;
+    for (int run = 0; run < runs; run++) {
+        for (dumpMode mode : modes) {
+            conway c;
+            if (loadCheckBoard(&c, pattern, wraps[run], rules[run], run + 1)) {
+                std::cerr << "Could not load " << pattern << std::endl;
+                return -1;
+            }
+
+            dump* d = dump_open(&c, path, mode, 0);
+            if (!d) {
+                std::cerr << "Could not create " << path << std::endl;
+                conway_destroy(&c);
+                return -1;
+            }
+
+            bool pushed = dump_push(d, &c) == 0;
+            for (long long gen = 1; gen <= generations && pushed; gen++) {
+                conway_simulate(&c);
+                pushed = dump_push(d, &c) == 0;
+            }
+            dumpStats stats;
+            bool written = dump_close(d, &stats) == 0 && pushed;
+
+            // the same generations again, each compared with the record read back
+            conway expected, readBack;
+            loadCheckBoard(&expected, pattern, wraps[run], rules[run], run + 1);
+            conway_init(&readBack, expected.wrap, expected.x, expected.y);
+
+            long long records = 0;
+            long long differing = 0;
+            int x, y;
+            dumpReader* r = written ? dump_openReader(path, &x, &y) : NULL;
+            if (r) {
+                int read;
+                while ((read = dump_read(r, &readBack)) == 1) {
+                    if (records) {
+                        conway_simulate(&expected);
+                    }
+                    if (readBack.generation != expected.generation ||
+                        memcmp(readBack.board, expected.board, (size_t)expected.x * expected.y)) {
+                        differing++;
+                    }
+                    records++;
+                }
+                differing += read < 0 ? 1 : 0;
+                dump_closeReader(r);
+            }
+            remove(path);
+
+            char rule[64];
+            conway_ruleString(&c, rule);
+            printf("%dx%d,%d,%s,%s,%lld,%lld,%lld,%lld,%.1f,%d,%.3f,%s\n", c.x, c.y, c.wrap, rule,
+                mode == DUMP_PACKED ? "packed" : "delta", generations, records, differing, stats.bytes,
+                (double)stats.bytes / 1e6 / stats.seconds, stats.maxQueueDepth, stats.stalled,
+                stats.uring ? "io_uring" : "thread pool");
+            fflush(stdout);
+
+            if (!written || !r || differing || records != generations + 1) {
+                ret = -1;
+            }
+
+            conway_destroy(&c);
+            conway_destroy(&expected);
+            conway_destroy(&readBack);
+        }
+    }
+
+    return ret;
+}
+
+int main(int argc, char** argv)
 {
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        // no window: --bench [pattern or "-" for a random soup] [frames]
+        const char* pattern = argc > 2 && strcmp(argv[2], "-") ? argv[2] : NULL;
+        return benchmarkRender(pattern, argc > 3 ? atoll(argv[3]) : 200);
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "--gpu-check")) {
+        // no window: --gpu-check [pattern or "-" for random soups] [generations]
+        const char* pattern = argc > 2 && strcmp(argv[2], "-") ? argv[2] : NULL;
+        return checkGpuSimulation(pattern, argc > 3 ? atoll(argv[3]) : 200);
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "--dump-check")) {
+        // no window: --dump-check [pattern or "-" for random soups] [generations] [scratch file]
+        const char* pattern = argc > 2 && strcmp(argv[2], "-") ? argv[2] : NULL;
+        return checkDump(pattern, argc > 3 ? atoll(argv[3]) : 1000, argc > 4 ? argv[4] : "dump-check.dump");
+    }
+
+    // options ahead of the pattern
+    for (;;) {
+        int used = 0;
+        if (argc > 2 && !strcmp(argv[1], "--profile")) {
+            // --profile log.csv: every phase timing written out
+            profileLog = argv[2];
+            used = 2;
+        }
+        else if (argc > 1 && !strcmp(argv[1], "--gpu")) {
+            gpuSimulate = true;
+            used = 1;
+        }
+        else if (argc > 2 && !strcmp(argv[1], "--dump")) {
+            // --dump gens.dump: every simulated generation written out, read back with dump_read
+            dumpPath = argv[2];
+            used = 2;
+        }
+        else {
+            break;
+        }
+
+        argv[used] = argv[0];
+        argc -= used;
+        argv += used;
+    }
+
+    if (argc > 3) {
+        // no window: pattern, frame path (per frame pattern, stream, "-" or "|command"), generations, [pixels per cell]
+        int scale = argc > 4 ? atoi(argv[4]) : 1;
+        if (scale < 1) {
+            std::cerr << "Scale must be at least one pixel per cell" << std::endl;
+            return -1;
+        }
+        return exportFrames(argv[1], argv[2], atoll(argv[3]), scale);
+    }
+
     std::cout << "Hello, world!\n" << std::endl;
 
 #define X 30
@@ -193,45 +856,42 @@ int main()
         INIT CONWAY
     */
     conway c;
-    conway_init(&c, 1, X, Y);
-
-    // GLIDER GUN (X = 30, Y = 100)
-    const char* seed[X] = {
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                1                                                                   ",
-        "                              1 1                                                                   ",
-        "                    11      11            11                                                        ",
-        "                   1   1    11            11                                                        ",
-        "        11        1     1   11                                                                      ",
-        "        11        1   1 11    1 1                                                                   ",
-        "                  1     1       1                                                                   ",
-        "                   1   1                                                                            ",
-        "                    11                                                                              ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    ",
-        "                                                                                                    " };
-    conway_seedTable(&c, (char**)seed, ' ');
+    if (argc > 1) {
+        // pattern file, board sized to fit
+        if (rle_load(&c, argv[1], 1)) {
+            std::cout << "Could not load " << argv[1] << std::endl;
+            return -1;
+        }
+        width = c.y;
+        height = c.x;
+    }
+    else {
+        conway_init(&c, 1, X, Y);
+
+        // GLIDER GUN
+        const char* gun =
+            "........................O\n"
+            "......................O.O\n"
+            "............OO......OO............OO\n"
+            "...........O...O....OO............OO\n"
+            "OO........O.....O...OO\n"
+            "OO........O...O.OO....O.O\n"
+            "..........O.....O.......O\n"
+            "...........O...O\n"
+            "............OO\n";
+        pattern seed;
+        pattern_parseCells(&seed, gun);
+        pattern_paste(&c, &seed, 9, 8, PATTERN_IDENTITY);
+        pattern_destroy(&seed);
+    }
+
+    // lets the renderer upload only what changed, and draw zoomed out from the density pyramid
+    conway_trackDensity(&c);
 
     int nr = 800;
-    char** output = conway_print(&c, '0', ' ', NULL);
-    printTable(output, c.x);
+    terminal term;
+    terminal_init(&term, c.x, c.y, TERMINAL_BRAILLE, terminalFps);
+    terminal_render(&term, &c);
     //system("cls");
 
     /*
@@ -240,104 +900,179 @@ int main()
 
     initGLFW(3, 3);
 
-    // window
+    // window, boards too large for it start zoomed out
+    unsigned int windowWidth = width * cellDim < maxWindowWidth ? width * cellDim : maxWindowWidth;
+    unsigned int windowHeight = height * cellDim < maxWindowHeight ? height * cellDim : maxWindowHeight;
     GLFWwindow* window = nullptr;
-    createWindow(window, title, width * cellDim, height * cellDim, framebufferSizeCallback);
+    createWindow(window, title, windowWidth, windowHeight, framebufferSizeCallback);
     if (!window) {
         std::cout << "Could not create window" << std::endl;
-        terminate(&c, output);
+        terminate(&c, &term);
         return -1;
     }
 
     // load glad
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cout << "Could not load GLAD" << std::endl;
-        terminate(&c, output);
+        terminate(&c, &term);
         return -1;
     }
 
     // set viewport
-    framebufferSizeCallback(window, width * cellDim, height * cellDim);
+    framebufferSizeCallback(window, windowWidth, windowHeight);
+
+    // generations on the GPU, drawn straight from its texture
+    gpuSimulation gpu;
+    if (gpuSimulate && dumpPath) {
+        // dumping needs every generation on the CPU
+        std::cout << "Dumping generations, simulating on the CPU" << std::endl;
+        gpuSimulate = false;
+    }
+    if (gpuSimulate) {
+        if (gpuSimulation_init(&gpu, &c)) {
+            std::cout << "Could not simulate on the GPU, simulating on the CPU" << std::endl;
+            gpuSimulate = false;
+        }
+        else {
+            renderMode = RENDERER_TEXTURE;
+        }
+    }
 
     /*
-        setup shaders
+        setup shaders and buffers
     */
-    GLuint shaderProgram = genShaderProgram("main.vs", "main.fs", "main.gs");
-    // set dimensions
-    glUseProgram(shaderProgram);
-    glUniform1i(glGetUniformLocation(shaderProgram, "width"), c.y);
-    glUniform1f(glGetUniformLocation(shaderProgram, "cellWidth"), 2.0f / (float)width);
-    glUniform1f(glGetUniformLocation(shaderProgram, "cellHeight"), 2.0f / (float)height);
+    renderer board;
+    if (renderer_init(&board, &c, renderMode)) {
+        std::cout << "Could not build shaders" << std::endl;
+        terminate(&c, &term);
+        return -1;
+    }
 
-    std::cout << 2.0f / (float)width << ' ' << 2.0f / (float)height << std::endl;
+    // phase timings
+    profiler prof;
+    if (profiler_init(&prof, profileLog)) {
+        std::cout << "Could not build shaders" << std::endl;
+        renderer_destroy(&board);
+        terminate(&c, &term);
+        return -1;
+    }
 
-    /*
-        setup VAO/VBO
-    */
-    GLuint VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    // VBO
-    GLuint VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    // set data
-    glBufferData(GL_ARRAY_BUFFER, c.x * c.y, c.board, GL_DYNAMIC_DRAW);
-    // set attribute pointers
-    glEnableVertexAttribArray(0);
-    // attribute index 0: 1 GL_BYTE per vertex, stride sizeof(char) to get to next vertex
-    glVertexAttribIPointer(0, 1, GL_BYTE, sizeof(char), 0);
-
-    // timing variables
-    double dt = 0.0;
-    double lastFrame = 0.0;
-    double timeSinceLastGen = 0.0;
-
-    // render initial configuration
-    renderScreen(window, shaderProgram, c, VAO, VBO);
+    // pan and zoom
+    viewState view;
+    view.board = &board;
+    view.width = windowWidth;
+    view.height = windowHeight;
+    view.cursorX = 0.0;
+    view.cursorY = 0.0;
+    glfwSetWindowUserPointer(window, &view);
+    setView(&view, renderer_fitView(&board, windowWidth, windowHeight));
+    glfwSetScrollCallback(window, scrollCallback);
+    glfwSetCursorPosCallback(window, cursorPosCallback);
+    glfwSetKeyCallback(window, keyCallback);
+
+    if (gpuSimulate) {
+        renderer_drawFrom(&board, gpuSimulation_texture(&gpu));
+    }
+    else {
+        // buffers the simulation thread writes frames into
+        renderer_initRing(&board, uploadSlots, (GLADloadproc)glfwGetProcAddress);
+
+        // render initial configuration
+        renderer_ringPush(&board, &c);
+        renderer_ringUpload(&board);
+    }
+    renderScreen(window, &board, &prof, view.width, view.height);
+    view.redraw = false;
+
+    // generations written as the simulation thread hands them over, starting from this one
+    dump* generationDump = NULL;
+    if (dumpPath) {
+        generationDump = dump_open(&c, dumpPath, dumpRecords, 0);
+        if (!generationDump || dump_push(generationDump, &c)) {
+            std::cout << "Could not dump to " << dumpPath << std::endl;
+            if (generationDump) {
+                dump_close(generationDump, NULL);
+            }
+            profiler_destroy(&prof);
+            renderer_destroy(&board);
+            terminate(&c, &term);
+            return -1;
+        }
+    }
+
+    // start simulating
+    simulation sim;
+    sim.running.store(true);
+    sim.generation.store(c.generation);
+    sim.dropped.store(0);
+    std::thread simulator;
+    gpuTimestep timestep = { 0.0, glfwGetTime() };
+    if (!gpuSimulate) {
+        simulator = std::thread(simulationThread, &c, &board, &term, &sim, &prof, generationDump);
+    }
+
+    long long frames = 0;
+    long long lastGeneration = c.generation;
+    long long lastDropped = 0;
+    double lastStats = glfwGetTime();
 
     while (!glfwWindowShouldClose(window))
     {
-        // update time
-        dt = glfwGetTime() - lastFrame;
-        lastFrame += dt;
-
         processInput(window);
 
-        // increment timer
-        timeSinceLastGen += dt;
-
-        if (timeSinceLastGen >= generationFrequency) {
-            // new generation
-            conway_simulate(&c);
-            output = conway_print(&c, '0', ' ', output);
-            printTable(output, c.x);
+        bool stepped = gpuSimulate && stepGpu(&gpu, &c, &term, &sim, &prof, &timestep);
+        if (stepped) {
+            renderer_drawFrom(&board, gpuSimulation_texture(&gpu));
+        }
 
-            // render update state
-            renderScreen(window, shaderProgram, c, VAO, VBO);
+        // render latest generation, if any, or the last one again if the view moved
+        if (stepped || (!gpuSimulate && uploadFrame(&board, &prof)) || view.redraw) {
+            view.redraw = false;
+            renderScreen(window, &board, &prof, view.width, view.height);
+            frames++;
+        }
 
-            // reset timer
-            timeSinceLastGen = 0.0;
+        double now = glfwGetTime();
+        if (now - lastStats >= statsFrequency) {
+            long long generation = sim.generation.load();
+            long long dropped = sim.dropped.load();
+            updateTitle(window, generation, generation - lastGeneration, frames, now - lastStats,
+                dropped > lastDropped, &prof, generationDump);
+
+            frames = 0;
+            lastGeneration = generation;
+            lastDropped = dropped;
+            lastStats = now;
         }
 
         // get new input
         glfwPollEvents();
     }
 
-    // clear buffers/arrays
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // stop simulating
+    sim.running.store(false);
+    if (simulator.joinable()) {
+        simulator.join();
+    }
 
-    // delete buffers/arrays
-    glDeleteBuffers(1, &VBO);
-    glDeleteVertexArrays(1, &VAO);
+    // finish writing generations
+    if (generationDump) {
+        dumpStats stats;
+        bool written = dump_close(generationDump, &stats) == 0;
+        std::cout << (written ? "Dumped " : "Dump failed after ") << stats.frames << " generations to " << dumpPath
+            << " (" << stats.bytes << " bytes, max queue depth " << stats.maxQueueDepth
+            << ", " << stats.stalled << " s stalled, " << (stats.uring ? "io_uring" : "thread pool") << ")" << std::endl;
+    }
 
-    // delete shaders
-    glDeleteProgram(shaderProgram);
+    // delete shaders and buffers
+    profiler_destroy(&prof);
+    renderer_destroy(&board);
+    if (gpuSimulate) {
+        gpuSimulation_destroy(&gpu);
+    }
 
     std::cout << "Goodbye" << std::endl;
-    terminate(&c, output);
+    terminate(&c, &term);
 
     return 0;
 }
\ No newline at end of file
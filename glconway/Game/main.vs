@@ -6,6 +6,8 @@ layout (location = 0) in int val;
 uniform int width;
 uniform float cellWidth;
 uniform float cellHeight;
+// board column and row at the bottom left of the screen
+uniform vec2 origin;
 
 // output structure
 out VS_OUT {
@@ -24,8 +26,8 @@ void main() {
 		// output bottom-left coordinate of each box
 		// grid cell --> [0, 1] x [0, 1] --> [-1, 1] x [-1, 1]
 		gl_Position = vec4(
-			col * cellWidth - 1.0,
-			row * cellHeight - 1.0,
+			(col - origin.x) * cellWidth - 1.0,
+			(row - origin.y) * cellHeight - 1.0,
 			0.0,
 			1.0
 		);
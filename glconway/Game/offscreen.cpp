@@ -0,0 +1,264 @@
+#include "offscreen.h"
+
+#include <string.h>
+#include <vector>
+
+#if defined(__linux__) && !defined(OFFSCREEN_NO_EGL)
+#define OFFSCREEN_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+struct offscreen {
+    int width;
+    int height;
+
+#ifdef OFFSCREEN_EGL
+    EGLDisplay display;
+    EGLContext context;
+    EGLSurface surface; // only when the context can't be made current without one
+#else
+    GLFWwindow* window;
+#endif
+
+    GLuint framebuffer;
+    GLuint color;
+
+    // pixel buffers read into in turn
+    int pixelBuffers;
+    std::vector<GLuint> buffers;
+    std::vector<GLsync> fences;
+    int head;    // next to read into
+    int pending; // reads not collected yet
+
+    std::vector<unsigned char> pixels; // last collected
+};
+
+static bool offscreen_hasExtension(const char* extensions, const char* name) {
+    size_t n = strlen(name);
+    for (const char* p = extensions; p && (p = strstr(p, name)); p += n) {
+        if ((p == extensions || p[-1] == ' ') && (p[n] == ' ' || p[n] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool offscreen_createContext(offscreen* o) {
+#ifdef OFFSCREEN_EGL
+    // Mesa's surfaceless platform needs no window system at all, otherwise the default display
+    o->display = EGL_NO_DISPLAY;
+    o->context = EGL_NO_CONTEXT;
+    o->surface = EGL_NO_SURFACE;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && offscreen_hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        o->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (o->display == EGL_NO_DISPLAY) {
+        o->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (o->display == EGL_NO_DISPLAY || !eglInitialize(o->display, NULL, NULL)) {
+        return false;
+    }
+
+    EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs = 0;
+    if (!eglChooseConfig(o->display, configAttribs, &config, 1, &configs) || configs < 1 ||
+        !eglBindAPI(EGL_OPENGL_API)) {
+        return false;
+    }
+
+    EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    o->context = eglCreateContext(o->display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (o->context == EGL_NO_CONTEXT) {
+        return false;
+    }
+
+    // everything is drawn into the framebuffer object, the surface only makes the context current
+    if (!offscreen_hasExtension(eglQueryString(o->display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        o->surface = eglCreatePbufferSurface(o->display, config, pbufferAttribs);
+    }
+
+    return eglMakeCurrent(o->display, o->surface, o->surface, o->context) &&
+        gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+#else
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    o->window = glfwCreateWindow(o->width, o->height, "offscreen", NULL, NULL);
+    if (!o->window) {
+        return false;
+    }
+
+    glfwMakeContextCurrent(o->window);
+    return gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+#endif
+}
+
+static void offscreen_destroyContext(offscreen* o) {
+#ifdef OFFSCREEN_EGL
+    if (o->display == EGL_NO_DISPLAY) {
+        return;
+    }
+
+    eglMakeCurrent(o->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (o->surface != EGL_NO_SURFACE) {
+        eglDestroySurface(o->display, o->surface);
+    }
+    if (o->context != EGL_NO_CONTEXT) {
+        eglDestroyContext(o->display, o->context);
+    }
+    eglTerminate(o->display);
+#else
+    if (o->window) {
+        glfwDestroyWindow(o->window);
+    }
+    glfwTerminate();
+#endif
+}
+
+offscreen* offscreen_open(int width, int height, int pixelBuffers) {
+    offscreen* o = new offscreen();
+    o->width = width;
+    o->height = height;
+
+    if (!offscreen_createContext(o)) {
+        offscreen_destroyContext(o);
+        delete o;
+        return NULL;
+    }
+
+    // color only, nothing is depth tested
+    glGenRenderbuffers(1, &o->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, o->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &o->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, o->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, o->color);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        offscreen_close(o);
+        return NULL;
+    }
+
+    o->pixelBuffers = pixelBuffers > 0 ? pixelBuffers : 1;
+    o->buffers.resize(o->pixelBuffers);
+    o->fences.resize(o->pixelBuffers, NULL);
+    o->head = 0;
+    o->pending = 0;
+    o->pixels.resize((size_t)width * height * 4);
+
+    size_t size = o->pixels.size();
+    glGenBuffers(o->pixelBuffers, o->buffers.data());
+    for (GLuint buffer : o->buffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    offscreen_bind(o);
+    return o;
+}
+
+GLADloadproc offscreen_loader(offscreen*) {
+#ifdef OFFSCREEN_EGL
+    return (GLADloadproc)eglGetProcAddress;
+#else
+    return (GLADloadproc)glfwGetProcAddress;
+#endif
+}
+
+void offscreen_bind(offscreen* o) {
+    glBindFramebuffer(GL_FRAMEBUFFER, o->framebuffer);
+    glViewport(0, 0, o->width, o->height);
+}
+
+int offscreen_read(offscreen* o) {
+    if (o->pending == o->pixelBuffers) {
+        return -1;
+    }
+
+    // returns at once, the copy lands in the buffer later
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, o->framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, o->buffers[o->head]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, o->width, o->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    o->fences[o->head] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    o->head = (o->head + 1) % o->pixelBuffers;
+    o->pending++;
+    return 0;
+}
+
+const unsigned char* offscreen_collect(offscreen* o, bool wait) {
+    if (!o->pending) {
+        return NULL;
+    }
+
+    int tail = (o->head - o->pending + o->pixelBuffers) % o->pixelBuffers;
+    GLenum status;
+    do {
+        status = glClientWaitSync(o->fences[tail], GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000 : 0);
+    } while (wait && status == GL_TIMEOUT_EXPIRED);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return NULL;
+    }
+    glDeleteSync(o->fences[tail]);
+    o->fences[tail] = NULL;
+
+    size_t size = o->pixels.size();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, o->buffers[tail]);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (mapped) {
+        memcpy(o->pixels.data(), mapped, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    o->pending--;
+    return mapped ? o->pixels.data() : NULL;
+}
+
+void offscreen_close(offscreen* o) {
+    if (!o) {
+        return;
+    }
+
+    for (GLsync fence : o->fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (!o->buffers.empty()) {
+        glDeleteBuffers((GLsizei)o->buffers.size(), o->buffers.data());
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &o->framebuffer);
+    glDeleteRenderbuffers(1, &o->color);
+
+    offscreen_destroyContext(o);
+    delete o;
+}
@@ -0,0 +1,33 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <glad/glad.h>
+
+/*
+    offscreen rendering
+    - a GL 3.3 core context without a window: EGL (surfaceless where supported, a 1x1 pbuffer
+      otherwise) on Linux, a hidden GLFW window elsewhere
+    - frames are drawn into a framebuffer object and read back through a ring of pixel buffers,
+      so reading one frame back overlaps drawing the next
+*/
+typedef struct offscreen offscreen;
+
+// makes the context current and loads GL, NULL if there is no way to get one
+offscreen* offscreen_open(int width, int height, int pixelBuffers);
+
+// GL entry points of the context, for what glad leaves out
+GLADloadproc offscreen_loader(offscreen* o);
+
+// draw into the framebuffer object, with the viewport covering it
+void offscreen_bind(offscreen* o);
+
+// start reading back what was drawn, -1 if every pixel buffer is waiting to be collected
+int offscreen_read(offscreen* o);
+
+// oldest frame read back, RGBA rows from the bottom up, valid until the next collect
+// NULL if none is queued, or without wait if it has not arrived yet
+const unsigned char* offscreen_collect(offscreen* o, bool wait);
+
+void offscreen_close(offscreen* o);
+
+#endif // OFFSCREEN_H
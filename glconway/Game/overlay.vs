@@ -0,0 +1,14 @@
+#version 330 core
+
+// pixels from the top left
+layout (location = 0) in vec2 pos;
+layout (location = 1) in vec4 color;
+
+uniform vec2 screen;
+
+out vec4 barColor;
+
+void main() {
+	barColor = color;
+	gl_Position = vec4(pos.x / screen.x * 2.0 - 1.0, 1.0 - pos.y / screen.y * 2.0, 0.0, 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+
+// 8 cells per texel, the cell in column 8 * i + j in bit j of texel i
+uniform usampler2D board;
+uniform int columns;
+
+// board column and row at the bottom left of the screen, cells across a pixel
+uniform vec2 origin;
+uniform float cellsPerPixel;
+
+out vec4 color;
+
+void main() {
+	ivec2 size = ivec2(columns, textureSize(board, 0).y);
+	ivec2 cell = ivec2(floor(origin + gl_FragCoord.xy * cellsPerPixel));
+	if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, size))) {
+		color = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	uint bits = texelFetch(board, ivec2(cell.x >> 3, cell.y), 0).r;
+	uint alive = (bits >> uint(cell.x & 7)) & 1u;
+	color = vec4(vec3(float(alive)), 1.0);
+}
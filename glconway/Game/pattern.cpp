@@ -0,0 +1,227 @@
+#include "pattern.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+// characters from a file or a string
+typedef struct
+{
+    FILE *file;
+    const char *text;
+} patternReader;
+
+static int pattern_getc(patternReader *r)
+{
+    if (r->file)
+    {
+        return getc(r->file);
+    }
+
+    return *r->text ? (unsigned char)*r->text++ : EOF;
+}
+
+// shift the cells so the bounding box starts at (0, 0)
+static void pattern_normalize(pattern *p)
+{
+    int minX = INT_MAX, minY = INT_MAX;
+    int maxX = INT_MIN, maxY = INT_MIN;
+    for (size_t i = 0; i < p->cells.size(); i += 2)
+    {
+        minX = p->cells[i] < minX ? p->cells[i] : minX;
+        maxX = p->cells[i] > maxX ? p->cells[i] : maxX;
+        minY = p->cells[i + 1] < minY ? p->cells[i + 1] : minY;
+        maxY = p->cells[i + 1] > maxY ? p->cells[i + 1] : maxY;
+    }
+
+    if (p->cells.empty())
+    {
+        p->rows = 0;
+        p->cols = 0;
+        return;
+    }
+
+    for (size_t i = 0; i < p->cells.size(); i += 2)
+    {
+        p->cells[i] -= minX;
+        p->cells[i + 1] -= minY;
+    }
+    p->rows = maxX - minX + 1;
+    p->cols = maxY - minY + 1;
+}
+
+static int pattern_readCells(pattern *p, patternReader *r)
+{
+    p->cells.clear();
+
+    int x = 0;
+    int y = 0;
+    bool comment = false;
+    int ch;
+    while ((ch = pattern_getc(r)) != EOF)
+    {
+        if (ch == '\n')
+        {
+            // comment lines don't count as rows
+            x += comment ? 0 : 1;
+            y = 0;
+            comment = false;
+        }
+        else if (comment || ch == '\r')
+        {
+            continue;
+        }
+        else if (ch == '!' && !y)
+        {
+            comment = true;
+        }
+        else
+        {
+            if (ch == 'O' || ch == '*')
+            {
+                p->cells.push_back(x);
+                p->cells.push_back(y);
+            }
+            y++;
+        }
+    }
+
+    pattern_normalize(p);
+    return 0;
+}
+
+int pattern_loadCells(pattern *p, const char *path)
+{
+    patternReader r = { fopen(path, "r"), NULL };
+    if (!r.file)
+    {
+        return -1;
+    }
+
+    int ret = pattern_readCells(p, &r);
+    fclose(r.file);
+    return ret;
+}
+
+int pattern_parseCells(pattern *p, const char *text)
+{
+    patternReader r = { NULL, text };
+    return pattern_readCells(p, &r);
+}
+
+int pattern_loadLife106(pattern *p, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return -1;
+    }
+
+    p->cells.clear();
+
+    char line[256];
+    int ret = 0;
+    bool header = false;
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#')
+        {
+            header = header || !strncmp(line, "#Life 1.06", 10);
+            continue;
+        }
+
+        int x, y;
+        char extra;
+        int n = sscanf(line, "%d %d %c", &x, &y, &extra);
+        if (n == 2)
+        {
+            p->cells.push_back(y);
+            p->cells.push_back(x);
+        }
+        else if (n != EOF)
+        {
+            ret = -1;
+            break;
+        }
+    }
+    fclose(file);
+
+    if (!header)
+    {
+        ret = -1;
+    }
+
+    pattern_normalize(p);
+    return ret;
+}
+
+int pattern_load(pattern *p, const char *path)
+{
+    const char *extension = strrchr(path, '.');
+    if (extension && (!strcmp(extension, ".lif") || !strcmp(extension, ".life")))
+    {
+        return pattern_loadLife106(p, path);
+    }
+
+    return pattern_loadCells(p, path);
+}
+
+void pattern_paste(conway *c, pattern *p, int x, int y, int orientation)
+{
+    int turns = orientation & 3;
+    bool flip = (orientation & PATTERN_FLIP) != 0;
+
+    // bounds of the cells written
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+
+    for (size_t i = 0; i < p->cells.size(); i += 2)
+    {
+        int r = p->cells[i];
+        int k = flip ? p->cols - 1 - p->cells[i + 1] : p->cells[i + 1];
+
+        // each quarter turn maps (r, k) in a rows x cols box to (k, rows - 1 - r) in a cols x rows box
+        int rows = p->rows;
+        int cols = p->cols;
+        for (int t = 0; t < turns; t++)
+        {
+            int next = k;
+            k = rows - 1 - r;
+            r = next;
+
+            int swap = rows;
+            rows = cols;
+            cols = swap;
+        }
+
+        r += x;
+        k += y;
+        if (c->wrap)
+        {
+            r = mod(r, c->x);
+            k = mod(k, c->y);
+        }
+        else if (r < 0 || r >= c->x || k < 0 || k >= c->y)
+        {
+            continue;
+        }
+
+        c->board[(size_t)r * c->y + k] = 1;
+        x0 = r < x0 ? r : x0;
+        y0 = k < y0 ? k : y0;
+        x1 = r > x1 ? r : x1;
+        y1 = k > y1 ? k : y1;
+    }
+
+    if (x0 <= x1)
+    {
+        conwayRect written = { x0, y0, x1 - x0 + 1, y1 - y0 + 1 };
+        conway_markChanged(c, written);
+    }
+}
+
+void pattern_destroy(pattern *p)
+{
+    std::vector<int>().swap(p->cells);
+    p->rows = 0;
+    p->cols = 0;
+}
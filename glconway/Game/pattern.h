@@ -0,0 +1,47 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <vector>
+
+#include "conway.h"
+
+/*
+    small patterns kept as lists of live cells
+    - plaintext (.cells): '!' comments, 'O' or '*' live, anything else dead
+    - Life 1.06 (.lif, .life): "#Life 1.06" then "x y" per live cell, x being the column
+    - pasting writes only the live cells into the board, in any of the 8 orientations
+    - functions return 0 on success, -1 on error
+*/
+typedef struct
+{
+    // bounding box, the top left live cell is at (0, 0)
+    int rows;
+    int cols;
+
+    // row, column pairs
+    std::vector<int> cells;
+} pattern;
+
+// quarter turns clockwise, optionally mirrored left to right first
+#define PATTERN_IDENTITY 0
+#define PATTERN_ROTATE_90 1
+#define PATTERN_ROTATE_180 2
+#define PATTERN_ROTATE_270 3
+#define PATTERN_FLIP 4
+
+int pattern_loadCells(pattern *p, const char *path);
+int pattern_loadLife106(pattern *p, const char *path);
+
+// format from the extension
+int pattern_load(pattern *p, const char *path);
+
+// plaintext from a string
+int pattern_parseCells(pattern *p, const char *text);
+
+// set the pattern's cells live with the top left of its oriented bounding box at row x, column y
+// cells falling off the board wrap around on wrapping boards and are dropped otherwise
+void pattern_paste(conway *c, pattern *p, int x, int y, int orientation);
+
+void pattern_destroy(pattern *p);
+
+#endif // PATTERN_H
@@ -0,0 +1,247 @@
+#include "profiler.h"
+#include "renderer.h"
+
+#include <algorithm>
+#include <string.h>
+
+static const char* profiler_names[PROFILER_PHASES] = {
+    "sim", "term", "dump", "push", "upload", "draw", "swap", "gpu-upload", "gpu-draw", "gpu-sim"
+};
+
+// overlay bar colors, the 95th percentile drawn at a third of the alpha
+static const float profiler_colors[PROFILER_PHASES][3] = {
+    { 0.3f, 0.8f, 0.3f },
+    { 0.6f, 0.6f, 0.6f },
+    { 0.3f, 0.8f, 0.8f },
+    { 0.3f, 0.6f, 0.9f },
+    { 0.9f, 0.7f, 0.2f },
+    { 0.9f, 0.4f, 0.2f },
+    { 0.7f, 0.4f, 0.9f },
+    { 1.0f, 0.9f, 0.4f },
+    { 1.0f, 0.5f, 0.4f },
+    { 0.5f, 1.0f, 0.5f }
+};
+
+#define PROFILER_VERTEX_FLOATS 6 // x, y, r, g, b, a
+#define PROFILER_RECTS (1 + 2 * PROFILER_PHASES)
+
+int profiler_init(profiler* p, const char* csvPath) {
+    memset(p->count, 0, sizeof(p->count));
+    memset(p->next, 0, sizeof(p->next));
+    memset(p->pending, 0, sizeof(p->pending));
+    memset(p->nextQuery, 0, sizeof(p->nextQuery));
+    p->active = -1;
+    p->start = profiler_start();
+
+    glGenQueries(PROFILER_PHASES * PROFILER_QUERIES, &p->queries[0][0]);
+
+    p->program = genShaderProgram("overlay.vs", "overlay.fs", NULL);
+    if (p->program == (GLuint)-1) {
+        glDeleteQueries(PROFILER_PHASES * PROFILER_QUERIES, &p->queries[0][0]);
+        return -1;
+    }
+
+    glGenVertexArrays(1, &p->VAO);
+    glBindVertexArray(p->VAO);
+    glGenBuffers(1, &p->VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, p->VBO);
+    glBufferData(GL_ARRAY_BUFFER, PROFILER_RECTS * 6 * PROFILER_VERTEX_FLOATS * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, PROFILER_VERTEX_FLOATS * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, PROFILER_VERTEX_FLOATS * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+
+    p->csv = NULL;
+    if (csvPath) {
+        p->csv = fopen(csvPath, "w");
+        if (p->csv) {
+            fprintf(p->csv, "seconds,phase,ms\n");
+        }
+        else {
+            printf("Could not open %s for the profile\n", csvPath);
+        }
+    }
+
+    return 0;
+}
+
+profilerTimer profiler_start() {
+    return std::chrono::steady_clock::now();
+}
+
+void profiler_stop(profiler* p, profilerPhase phase, profilerTimer start) {
+    profiler_add(p, phase, std::chrono::duration<double, std::milli>(profiler_start() - start).count());
+}
+
+void profiler_add(profiler* p, profilerPhase phase, double ms) {
+    std::lock_guard<std::mutex> guard(p->lock);
+
+    p->samples[phase][p->next[phase]] = (float)ms;
+    p->next[phase] = (p->next[phase] + 1) % PROFILER_SAMPLES;
+    if (p->count[phase] < PROFILER_SAMPLES) {
+        p->count[phase]++;
+    }
+
+    if (p->csv) {
+        double seconds = std::chrono::duration<double>(profiler_start() - p->start).count();
+        fprintf(p->csv, "%.6f,%s,%.4f\n", seconds, profiler_names[phase], ms);
+    }
+}
+
+void profiler_beginQuery(profiler* p, profilerPhase phase) {
+    int q = p->nextQuery[phase];
+    if (p->active >= 0 || p->pending[phase][q]) {
+        // still in flight, leave this one out rather than wait
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, p->queries[phase][q]);
+    p->active = phase;
+}
+
+void profiler_endQuery(profiler* p) {
+    if (p->active < 0) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    int phase = p->active;
+    p->pending[phase][p->nextQuery[phase]] = true;
+    p->nextQuery[phase] = (p->nextQuery[phase] + 1) % PROFILER_QUERIES;
+    p->active = -1;
+}
+
+void profiler_collect(profiler* p) {
+    for (int phase = 0; phase < PROFILER_PHASES; phase++) {
+        // oldest first, so samples stay in order
+        for (int i = 0; i < PROFILER_QUERIES; i++) {
+            int q = (p->nextQuery[phase] + i) % PROFILER_QUERIES;
+            if (!p->pending[phase][q]) {
+                continue;
+            }
+
+            GLint available = 0;
+            glGetQueryObjectiv(p->queries[phase][q], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+
+            GLuint64 ns;
+            glGetQueryObjectui64v(p->queries[phase][q], GL_QUERY_RESULT, &ns);
+            p->pending[phase][q] = false;
+            profiler_add(p, (profilerPhase)phase, ns / 1e6);
+        }
+    }
+}
+
+double profiler_percentile(profiler* p, profilerPhase phase, double q) {
+    float sorted[PROFILER_SAMPLES];
+    int n;
+    {
+        std::lock_guard<std::mutex> guard(p->lock);
+        n = p->count[phase];
+        memcpy(sorted, p->samples[phase], n * sizeof(float));
+    }
+
+    if (!n) {
+        return -1.0;
+    }
+
+    int i = std::min(n - 1, std::max(0, (int)(q * (n - 1) + 0.5)));
+    std::nth_element(sorted, sorted + i, sorted + n);
+    return sorted[i];
+}
+
+void profiler_summary(profiler* p, char* buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int phase = 0; phase < PROFILER_PHASES && len < size; phase++) {
+        double median = profiler_percentile(p, (profilerPhase)phase, 0.5);
+        if (median < 0.0) {
+            continue;
+        }
+
+        double tail = profiler_percentile(p, (profilerPhase)phase, 0.95);
+        int written = snprintf(buf + len, size - len, "%s%s %.2f/%.2f",
+            len ? ", " : "", profiler_names[phase], median, tail);
+        if (written < 0) {
+            break;
+        }
+        len += written;
+    }
+}
+
+static float* profiler_rect(float* v, float x0, float y0, float x1, float y1, const float color[3], float alpha) {
+    const float corners[6][2] = {
+        { x0, y0 }, { x1, y0 }, { x1, y1 },
+        { x0, y0 }, { x1, y1 }, { x0, y1 }
+    };
+    for (int i = 0; i < 6; i++) {
+        *v++ = corners[i][0];
+        *v++ = corners[i][1];
+        *v++ = color[0];
+        *v++ = color[1];
+        *v++ = color[2];
+        *v++ = alpha;
+    }
+    return v;
+}
+
+void profiler_drawOverlay(profiler* p, int width, int height, double msWidth) {
+    const float margin = 8.0f;
+    const float barWidth = 200.0f;
+    const float barHeight = 10.0f;
+    const float gap = 4.0f;
+    const float background[3] = { 0.0f, 0.0f, 0.0f };
+
+    float vertices[PROFILER_RECTS * 6 * PROFILER_VERTEX_FLOATS];
+    float* v = profiler_rect(vertices, margin - gap, margin - gap,
+        margin + barWidth + gap, margin + (int)PROFILER_PHASES * (barHeight + gap), background, 0.6f);
+
+    for (int phase = 0; phase < PROFILER_PHASES; phase++) {
+        double median = profiler_percentile(p, (profilerPhase)phase, 0.5);
+        if (median < 0.0) {
+            continue;
+        }
+        double tail = profiler_percentile(p, (profilerPhase)phase, 0.95);
+
+        float y0 = margin + phase * (barHeight + gap);
+        float medianX = margin + barWidth * (float)std::min(1.0, median / msWidth);
+        float tailX = margin + barWidth * (float)std::min(1.0, tail / msWidth);
+        v = profiler_rect(v, margin, y0, tailX, y0 + barHeight, profiler_colors[phase], 0.35f);
+        v = profiler_rect(v, margin, y0, medianX, y0 + barHeight, profiler_colors[phase], 1.0f);
+    }
+    int count = (int)(v - vertices) / PROFILER_VERTEX_FLOATS;
+
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(p->program);
+    glUniform2f(glGetUniformLocation(p->program, "screen"), (float)width, (float)height);
+    glBindVertexArray(p->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, p->VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * PROFILER_VERTEX_FLOATS * sizeof(float), vertices);
+    glDrawArrays(GL_TRIANGLES, 0, count);
+    glBindVertexArray(0);
+
+    if (!blend) {
+        glDisable(GL_BLEND);
+    }
+}
+
+void profiler_destroy(profiler* p) {
+    if (p->active >= 0) {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+    glDeleteQueries(PROFILER_PHASES * PROFILER_QUERIES, &p->queries[0][0]);
+    glDeleteVertexArrays(1, &p->VAO);
+    glDeleteBuffers(1, &p->VBO);
+    glDeleteProgram(p->program);
+
+    if (p->csv) {
+        fclose(p->csv);
+        p->csv = NULL;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+
+/*
+    frame profiler
+    - phases are timed on the CPU, from any thread, and GL work also with GL_TIME_ELAPSED queries
+    - each GPU phase has PROFILER_QUERIES queries used in turn and read only once their result is
+      available, a few frames later, so timing never stalls the pipeline (a frame is left out
+      instead if they are all still in flight)
+    - the last PROFILER_SAMPLES samples of each phase give rolling percentiles, drawn as bars
+      over the board (median solid, 95th percentile behind it) and summarized as text
+    - every sample can also be appended to a CSV file
+*/
+typedef enum {
+    PROFILER_SIMULATE,  // one generation
+    PROFILER_TERMINAL,  // terminal redraw
+    PROFILER_DUMP,      // generation handed to the dump writer
+    PROFILER_PUSH,      // frame written for the GPU
+    PROFILER_UPLOAD,    // frame sent to the GPU
+    PROFILER_DRAW,      // board draw calls
+    PROFILER_SWAP,      // buffer swap
+    PROFILER_GPU_UPLOAD,
+    PROFILER_GPU_DRAW,
+    PROFILER_GPU_SIMULATE, // generations stepped on the GPU
+    PROFILER_PHASES
+} profilerPhase;
+
+#define PROFILER_SAMPLES 256
+#define PROFILER_QUERIES 4
+
+typedef std::chrono::steady_clock::time_point profilerTimer;
+
+typedef struct {
+    // milliseconds, PROFILER_SAMPLES per phase in a ring
+    float samples[PROFILER_PHASES][PROFILER_SAMPLES];
+    int count[PROFILER_PHASES];
+    int next[PROFILER_PHASES];
+    std::mutex lock;
+
+    // GPU phases
+    GLuint queries[PROFILER_PHASES][PROFILER_QUERIES];
+    bool pending[PROFILER_PHASES][PROFILER_QUERIES];
+    int nextQuery[PROFILER_PHASES];
+    int active; // phase being queried, -1 if none
+
+    // overlay
+    GLuint program;
+    GLuint VAO;
+    GLuint VBO;
+
+    FILE* csv;
+    profilerTimer start;
+} profiler;
+
+// csvPath may be NULL, returns -1 if the overlay shaders could not be built
+int profiler_init(profiler* p, const char* csvPath);
+
+profilerTimer profiler_start();
+// adds the time since start to phase
+void profiler_stop(profiler* p, profilerPhase phase, profilerTimer start);
+void profiler_add(profiler* p, profilerPhase phase, double ms);
+
+// GL thread: time the GL commands between the two
+void profiler_beginQuery(profiler* p, profilerPhase phase);
+void profiler_endQuery(profiler* p);
+// GL thread: add the results that have arrived
+void profiler_collect(profiler* p);
+
+// milliseconds at fraction q (0.5 for the median) of the last samples, -1 without samples
+double profiler_percentile(profiler* p, profilerPhase phase, double q);
+
+// "phase median/95th" for the phases with samples
+void profiler_summary(profiler* p, char* buf, size_t size);
+
+// GL thread: bars in the top left of a width x height framebuffer, msWidth milliseconds across
+void profiler_drawOverlay(profiler* p, int width, int height, double msWidth);
+
+void profiler_destroy(profiler* p);
+
+#endif // PROFILER_H
@@ -0,0 +1,762 @@
+#include "renderer.h"
+#include "compress.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+/*
+    Shader methods
+*/
+
+std::string readFile(const char* filename) {
+    std::ifstream file;
+    std::stringstream buf;
+
+    std::string ret;
+
+    // open file
+    file.open(filename);
+
+    if (file.is_open()) {
+        // read file
+        buf << file.rdbuf();
+        ret = buf.str();
+        file.close();
+    }
+    else {
+        std::cout << "Could not read " << filename << std::endl;
+    }
+
+    return ret;
+}
+
+int genShader(const char* filename, GLenum type) {
+    std::string shaderSrc = readFile(filename);
+    const GLchar* shader = shaderSrc.c_str();
+
+    // build and compile
+    int shaderObj = glCreateShader(type);
+    glShaderSource(shaderObj, 1, &shader, NULL);
+    glCompileShader(shaderObj);
+
+    // check for errors
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shaderObj, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shaderObj, 512, NULL, infoLog);
+        std::cout << "Error in shader compilation: " << infoLog << std::endl;
+        return -1;
+    }
+
+    return shaderObj;
+}
+
+int genShaderProgram(const char* vertexShaderPath,
+    const char* fragmentShaderPath,
+    const char* geoShaderPath) {
+    int shaderProgram = glCreateProgram();
+
+    // compile shaders
+    int vShader = genShader(vertexShaderPath, GL_VERTEX_SHADER);
+    int fShader = genShader(fragmentShaderPath, GL_FRAGMENT_SHADER);
+    int gShader = geoShaderPath ? genShader(geoShaderPath, GL_GEOMETRY_SHADER) : 0;
+
+    if (vShader == -1 || fShader == -1 || gShader == -1) {
+        return -1;
+    }
+
+    // link
+    glAttachShader(shaderProgram, vShader);
+    glAttachShader(shaderProgram, fShader);
+    if (gShader) {
+        glAttachShader(shaderProgram, gShader);
+    }
+    glLinkProgram(shaderProgram);
+
+    // check for errors
+    int success;
+    char infoLog[512];
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+        std::cout << "Error in shader linking: " << infoLog << std::endl;
+        return -1;
+    }
+
+    glDeleteShader(vShader);
+    glDeleteShader(fShader);
+    if (gShader) {
+        glDeleteShader(gShader);
+    }
+
+    return shaderProgram;
+}
+
+/*
+    Rendering
+*/
+
+// board frames with 8 cells a byte
+static bool renderer_packed(rendererMode mode) {
+    return mode == RENDERER_PACKED || mode == RENDERER_INSTANCED;
+}
+
+// bytes per board row in a frame
+static int renderer_rowBytes(rendererMode mode, int y) {
+    return renderer_packed(mode) ? (y + 7) / 8 : y;
+}
+
+// board part of a frame, padded so the stamps are aligned
+static size_t renderer_boardBytes(rendererMode mode, int x, int y) {
+    return ((size_t)x * renderer_rowBytes(mode, y) + 7) / 8 * 8;
+}
+
+// generation, whether stamps follow, then one stamp per tile
+static long long* renderer_frameStamps(rendererMode mode, int x, int y, const char* frame) {
+    return (long long*)(frame + renderer_boardBytes(mode, x, y));
+}
+
+// nearest texel, clamped
+static GLuint renderer_genTexture() {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+int renderer_init(renderer* r, conway* c, rendererMode mode) {
+    r->mode = mode;
+    r->x = c->x;
+    r->y = c->y;
+    r->VBO = 0;
+    r->texture = 0;
+    r->source = 0;
+    r->windowProgram = 0;
+    r->windowTexture = 0;
+    r->cellsProgram = 0;
+    r->cellsVAO = 0;
+    r->cells = -1;
+    r->generation = c->generation;
+    r->window = { -1, 0, 0, c->x, c->y };
+    r->ring.slots = 0;
+
+    glGenVertexArrays(1, &r->VAO);
+    glBindVertexArray(r->VAO);
+
+    if (mode == RENDERER_POINTS) {
+        r->program = genShaderProgram("main.vs", "main.fs", "main.gs");
+        if (r->program == (GLuint)-1) {
+            return -1;
+        }
+
+        // set dimensions, cell sizes follow the view
+        glUseProgram(r->program);
+        glUniform1i(glGetUniformLocation(r->program, "width"), c->y);
+
+        // VBO
+        glGenBuffers(1, &r->VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, r->VBO);
+        // set data
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)c->x * c->y, c->board, GL_DYNAMIC_DRAW);
+        // set attribute pointers
+        glEnableVertexAttribArray(0);
+        // attribute index 0: 1 GL_BYTE per vertex, stride sizeof(char) to get to next vertex
+        glVertexAttribIPointer(0, 1, GL_BYTE, sizeof(char), 0);
+    }
+    else {
+        bool packed = renderer_packed(mode);
+        r->program = genShaderProgram("texture.vs", packed ? "packed.fs" : "texture.fs", NULL);
+        if (r->program == (GLuint)-1) {
+            return -1;
+        }
+
+        glUseProgram(r->program);
+        glUniform1i(glGetUniformLocation(r->program, "board"), 0);
+        if (packed) {
+            glUniform1i(glGetUniformLocation(r->program, "columns"), c->y);
+        }
+
+        // one unsigned byte per cell (or per 8 cells), a row per board row, if it fits
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        if (renderer_rowBytes(mode, c->y) <= maxSize && c->x <= maxSize) {
+            std::vector<char> frame(renderer_frameSize(mode, c->x, c->y));
+            renderer_writeFrame(mode, c, frame.data());
+
+            r->texture = renderer_genTexture();
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, renderer_rowBytes(mode, c->y), c->x, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, frame.data());
+        }
+
+        // visible blocks of a density level, a normalized byte per block
+        r->windowProgram = genShaderProgram("texture.vs", "window.fs", NULL);
+        if (r->windowProgram == (GLuint)-1) {
+            return -1;
+        }
+
+        glUseProgram(r->windowProgram);
+        glUniform1i(glGetUniformLocation(r->windowProgram, "window"), 0);
+        glUniform2i(glGetUniformLocation(r->windowProgram, "board"), c->y, c->x);
+        r->windowTexture = renderer_genTexture();
+    }
+
+    if (mode == RENDERER_INSTANCED) {
+        // a quad per live cell, no geometry shader
+        r->cellsProgram = genShaderProgram("instanced.vs", "main.fs", NULL);
+        if (r->cellsProgram == (GLuint)-1) {
+            return -1;
+        }
+
+        // the cells come from ring slots, the buffer is bound as each list is uploaded
+        glGenVertexArrays(1, &r->cellsVAO);
+        glBindVertexArray(r->cellsVAO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribDivisor(0, 1);
+        glBindVertexArray(r->VAO);
+    }
+
+    // fit the board to the current viewport until told otherwise
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    renderer_setView(r, renderer_fitView(r, viewport[2], viewport[3]), viewport[2], viewport[3]);
+
+    return 0;
+}
+
+size_t renderer_frameSize(rendererMode mode, int x, int y) {
+    size_t stamps = (size_t)conway_tileRows(x) * conway_tileCols(y);
+    return renderer_boardBytes(mode, x, y) + (2 + stamps) * sizeof(long long);
+}
+
+static void renderer_writeBoard(rendererMode mode, conway* c, char* board) {
+    if (!renderer_packed(mode)) {
+        memcpy(board, c->board, (size_t)c->x * c->y);
+        return;
+    }
+
+    // rows are packed separately so each starts on a byte
+    int rowBytes = renderer_rowBytes(mode, c->y);
+    for (int x = 0; x < c->x; x++) {
+        compress_packBits(c->board + (size_t)x * c->y, c->y, (unsigned char*)board + (size_t)x * rowBytes);
+    }
+}
+
+// write only the tiles changed after generation since into board, which already holds that generation
+static void renderer_writeChanged(rendererMode mode, conway* c, char* board, long long since) {
+    conwayRect rects[RENDERER_MAX_RECTS];
+    int n = conway_changedRects(c->changed, c->x, c->y, since, rects, RENDERER_MAX_RECTS);
+
+    // rect columns start on tiles, so on whole bytes when packed
+    int rowBytes = renderer_rowBytes(mode, c->y);
+    for (int i = 0; i < n; i++) {
+        for (int x = rects[i].x; x < rects[i].x + rects[i].rows; x++) {
+            const char* cells = c->board + (size_t)x * c->y + rects[i].y;
+            if (renderer_packed(mode)) {
+                compress_packBits(cells, rects[i].cols, (unsigned char*)board + (size_t)x * rowBytes + rects[i].y / 8);
+            }
+            else {
+                memcpy(board + (size_t)x * rowBytes + rects[i].y, cells, rects[i].cols);
+            }
+        }
+    }
+}
+
+static void renderer_writeStamps(conway* c, long long* stamps) {
+    stamps[0] = c->generation;
+    stamps[1] = c->changed != NULL;
+    if (c->changed) {
+        memcpy(stamps + 2, c->changed, (size_t)conway_tileRows(c->x) * conway_tileCols(c->y) * sizeof(long long));
+    }
+}
+
+void renderer_writeFrame(rendererMode mode, conway* c, char* frame) {
+    renderer_writeBoard(mode, c, frame);
+    renderer_writeStamps(c, renderer_frameStamps(mode, c->x, c->y, frame));
+}
+
+// upload the rows and columns of rect from board, an offset into the bound buffer if one is bound
+static void renderer_uploadRect(renderer* r, const char* board, conwayRect rect) {
+    if (r->mode == RENDERER_POINTS) {
+        // whole rows, the buffer has no pitch
+        size_t offset = (size_t)rect.x * r->y;
+        glBufferSubData(GL_ARRAY_BUFFER, offset, (GLsizeiptr)rect.rows * r->y, board + offset);
+        return;
+    }
+
+    // texels rather than cells when packed, rect columns start on tiles so on whole bytes
+    int rowBytes = renderer_rowBytes(r->mode, r->y);
+    int y0 = renderer_packed(r->mode) ? rect.y / 8 : rect.y;
+    int y1 = renderer_packed(r->mode) ? (rect.y + rect.cols + 7) / 8 : rect.y + rect.cols;
+    size_t offset = (size_t)rect.x * rowBytes + y0;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, y0, rect.x, y1 - y0, rect.rows, GL_RED_INTEGER, GL_UNSIGNED_BYTE,
+        (const void*)((uintptr_t)board + offset));
+}
+
+// upload what changed since the frame on the GPU, board being NULL when it comes from an unpack buffer
+static void renderer_uploadFrom(renderer* r, const char* board, const long long* stamps) {
+    long long generation = stamps[0];
+    bool tracked = stamps[1] != 0;
+
+    conwayRect rects[RENDERER_MAX_RECTS];
+    int n = 1;
+    rects[0] = { 0, 0, r->x, r->y };
+    if (tracked && generation >= r->generation) {
+        n = conway_changedRects(stamps + 2, r->x, r->y, r->generation, rects, RENDERER_MAX_RECTS);
+    }
+    r->generation = generation;
+    r->window.level = -1;
+    r->cells = -1;
+
+    if (r->mode == RENDERER_POINTS) {
+        glBindBuffer(GL_ARRAY_BUFFER, r->VBO);
+    }
+    else {
+        glBindTexture(GL_TEXTURE_2D, r->texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, renderer_rowBytes(r->mode, r->y));
+    }
+
+    for (int i = 0; i < n; i++) {
+        renderer_uploadRect(r, board, rects[i]);
+    }
+
+    if (r->mode != RENDERER_POINTS) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+}
+
+// blocks of the window, NULL when they come from an unpack buffer
+static void renderer_uploadWindow(renderer* r, const unsigned char* blocks, rendererWindow window) {
+    glBindTexture(GL_TEXTURE_2D, r->windowTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, window.cols, window.rows, 0, GL_RED, GL_UNSIGNED_BYTE, blocks);
+    r->window = window;
+    r->cells = -1;
+}
+
+/*
+    View
+*/
+
+// bytes of window a frame may need, four a pixel
+static size_t renderer_windowBytes(int width, int height) {
+    return (size_t)4 * (width + 2) * (height + 2);
+}
+
+// blocks the view needs, level -1 when the board texture will do
+static rendererWindow renderer_viewWindow(renderer* r) {
+    rendererWindow window = { -1, 0, 0, r->x, r->y };
+    if (r->mode == RENDERER_POINTS) {
+        return window;
+    }
+
+    // the coarsest level whose blocks are no larger than a pixel (so more than half a pixel)
+    double cellsPerPixel = 1.0 / r->view.scale;
+    int levels = conway_densityLevels(r->x, r->y);
+    int level = 0;
+    while (level < levels && (double)(2LL << level) <= cellsPerPixel) {
+        level++;
+    }
+    if (level == 0 && r->texture) {
+        return window;
+    }
+
+    // visible cells, clamped to the board
+    long long x0 = (long long)floor(r->view.x);
+    long long y0 = (long long)floor(r->view.y);
+    long long x1 = (long long)ceil(r->view.x + r->height * cellsPerPixel);
+    long long y1 = (long long)ceil(r->view.y + r->width * cellsPerPixel);
+    x0 = std::min(std::max(x0, 0LL), (long long)r->x);
+    y0 = std::min(std::max(y0, 0LL), (long long)r->y);
+    x1 = std::min(std::max(x1, x0), (long long)r->x);
+    y1 = std::min(std::max(y1, y0), (long long)r->y);
+
+    // coarser while the blocks covering them don't fit in a slot
+    size_t capacity = r->ring.slots ? r->ring.size : renderer_windowBytes(r->width, r->height);
+    for (;; level++) {
+        long long block = 1LL << level;
+        window.level = level;
+        window.x = (int)(x0 >> level);
+        window.y = (int)(y0 >> level);
+        window.rows = (int)((x1 + block - 1) >> level) - window.x;
+        window.cols = (int)((y1 + block - 1) >> level) - window.y;
+        if ((size_t)window.rows * window.cols <= capacity || level >= levels) {
+            return window;
+        }
+    }
+}
+
+void renderer_setView(renderer* r, rendererView view, int width, int height) {
+    r->view = view;
+    r->width = width;
+    r->height = height;
+
+    rendererWindow request = renderer_viewWindow(r);
+    std::lock_guard<std::mutex> guard(r->viewLock);
+    r->request = request;
+}
+
+rendererView renderer_fitView(renderer* r, int width, int height) {
+    rendererView view;
+    view.scale = std::min((double)width / std::max(r->y, 1), (double)height / std::max(r->x, 1));
+    view.x = 0.5 * (r->x - height / view.scale);
+    view.y = 0.5 * (r->y - width / view.scale);
+    return view;
+}
+
+/*
+    Upload ring
+*/
+
+// not in the 3.3 loader
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP rendererBufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+static size_t renderer_slotStamps(renderer* r) {
+    return 2 + (size_t)conway_tileRows(r->x) * conway_tileCols(r->y);
+}
+
+// map a free slot for the writer, unsynchronized as the slot's fence has already passed, and
+// without invalidating, as the board the slot holds is only updated where it changed
+static void renderer_mapSlot(renderer* r, int s) {
+    glBindBuffer(r->ring.target, r->ring.buffers[s]);
+    r->ring.mapped[s] = (char*)glMapBufferRange(r->ring.target, 0, r->ring.size,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void renderer_initRing(renderer* r, int slots, GLADloadproc load) {
+    rendererRing* ring = &r->ring;
+    ring->slots = slots;
+    ring->target = r->mode == RENDERER_POINTS ? GL_ARRAY_BUFFER : GL_PIXEL_UNPACK_BUFFER;
+    ring->size = r->mode == RENDERER_POINTS || r->texture ? renderer_boardBytes(r->mode, r->x, r->y) : 0;
+    if (r->mode != RENDERER_POINTS) {
+        // or the visible blocks, for the framebuffer as it is now
+        ring->size = std::max(ring->size, renderer_windowBytes(r->width, r->height));
+    }
+    ring->latest.store(-1);
+    ring->dropped.store(false);
+    ring->shown = -1;
+
+    // persistent mapping needs 4.4 (or ARB_buffer_storage, not checked here)
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    rendererBufferStorage bufferStorage = NULL;
+    if (load && (major > 4 || (major == 4 && minor >= 4))) {
+        bufferStorage = (rendererBufferStorage)load("glBufferStorage");
+    }
+    ring->persistent = bufferStorage != NULL;
+
+    ring->buffers = new GLuint[slots];
+    ring->mapped = new char*[slots];
+    ring->fences = new GLsync[slots];
+    ring->stamps = new long long*[slots];
+    ring->windows = new rendererWindow[slots];
+    ring->cells = new long long[slots];
+    ring->boards = new long long[slots];
+    ring->state = new std::atomic<int>[slots];
+
+    glGenBuffers(slots, ring->buffers);
+    for (int s = 0; s < slots; s++) {
+        ring->fences[s] = NULL;
+        ring->stamps[s] = new long long[renderer_slotStamps(r)];
+        ring->boards[s] = -1;
+        ring->state[s].store(RENDERER_SLOT_FREE);
+
+        glBindBuffer(ring->target, ring->buffers[s]);
+        if (ring->persistent) {
+            // mapped once for the ring's lifetime
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(ring->target, ring->size, NULL, flags);
+            ring->mapped[s] = (char*)glMapBufferRange(ring->target, 0, ring->size, flags);
+        }
+        else {
+            glBufferData(ring->target, ring->size, NULL, GL_STREAM_DRAW);
+            renderer_mapSlot(r, s);
+        }
+    }
+    glBindBuffer(ring->target, 0);
+
+    if (r->mode == RENDERER_POINTS) {
+        // the VAO still points at the initial buffer
+        glBindBuffer(GL_ARRAY_BUFFER, r->VBO);
+    }
+
+    // windows are now limited to a slot
+    renderer_setView(r, r->view, r->width, r->height);
+}
+
+bool renderer_ringPush(renderer* r, conway* c) {
+    rendererRing* ring = &r->ring;
+
+    // claim a free slot
+    int s = 0;
+    for (; s < ring->slots; s++) {
+        int expected = RENDERER_SLOT_FREE;
+        if (ring->state[s].compare_exchange_strong(expected, RENDERER_SLOT_WRITING)) {
+            break;
+        }
+    }
+    if (s == ring->slots) {
+        // GPU is behind, drop the frame until a slot frees up
+        ring->dropped.store(true);
+        return false;
+    }
+    ring->dropped.store(false);
+
+    rendererWindow window;
+    {
+        std::lock_guard<std::mutex> guard(r->viewLock);
+        window = r->request;
+    }
+
+    // at a cell per pixel or more, sparse enough to list, and the list fits
+    long long population = r->mode == RENDERER_INSTANCED && window.level <= 0 ? conway_population(c) : -1;
+    bool sparse = population >= 0 && population * RENDERER_SPARSE < (long long)c->x * c->y &&
+        (size_t)population * 2 * sizeof(int) <= ring->size;
+
+    ring->cells[s] = -1;
+    if (sparse) {
+        // only what was written is drawn, should the count have been stale
+        long long listed = conway_liveCells(c, (int*)ring->mapped[s], population);
+        ring->cells[s] = std::min(listed, population);
+        ring->stamps[s][0] = c->generation;
+        ring->stamps[s][1] = 0;
+        ring->boards[s] = -1;
+        window.level = -1;
+    }
+    else if (window.level >= 0) {
+        // just what the view shows
+        conway_densityWindow(c, window.level, window.x, window.y, window.rows, window.cols,
+            (unsigned char*)ring->mapped[s]);
+        ring->stamps[s][0] = c->generation;
+        ring->stamps[s][1] = 0;
+        ring->boards[s] = -1;
+    }
+    else {
+        // a slot still holding an earlier generation of the board only needs the tiles changed since
+        if (c->changed && ring->boards[s] >= 0 && ring->boards[s] <= c->generation) {
+            renderer_writeChanged(r->mode, c, ring->mapped[s], ring->boards[s]);
+        }
+        else {
+            renderer_writeBoard(r->mode, c, ring->mapped[s]);
+        }
+        renderer_writeStamps(c, ring->stamps[s]);
+        ring->boards[s] = c->generation;
+    }
+    ring->windows[s] = window;
+
+    // publish, the frame it replaces was never uploaded
+    ring->state[s].store(RENDERER_SLOT_READY);
+    int old = ring->latest.exchange(s);
+    if (old >= 0) {
+        ring->state[old].store(RENDERER_SLOT_FREE);
+    }
+
+    return true;
+}
+
+bool renderer_ringPending(renderer* r) {
+    return r->ring.latest.load() >= 0;
+}
+
+bool renderer_ringDropped(renderer* r) {
+    return r->ring.dropped.load();
+}
+
+bool renderer_ringUpload(renderer* r) {
+    rendererRing* ring = &r->ring;
+
+    // recycle slots the GPU has finished reading
+    for (int s = 0; s < ring->slots; s++) {
+        if (!ring->fences[s] || glClientWaitSync(ring->fences[s], 0, 0) == GL_TIMEOUT_EXPIRED) {
+            continue;
+        }
+
+        glDeleteSync(ring->fences[s]);
+        ring->fences[s] = NULL;
+        if (!ring->persistent) {
+            renderer_mapSlot(r, s);
+        }
+        ring->state[s].store(RENDERER_SLOT_FREE);
+    }
+    glBindBuffer(ring->target, 0);
+
+    int s = ring->latest.exchange(-1);
+    if (s < 0) {
+        return false;
+    }
+
+    // the slot now belongs to this thread, the writer only claims free slots
+    ring->state[s].store(RENDERER_SLOT_GPU);
+    glBindBuffer(ring->target, ring->buffers[s]);
+    if (!ring->persistent) {
+        glUnmapBuffer(ring->target);
+        ring->mapped[s] = NULL;
+    }
+
+    // the slot drawn from until now is free once its draws are done
+    if (ring->shown >= 0) {
+        ring->fences[ring->shown] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ring->shown = -1;
+    }
+
+    if (r->mode == RENDERER_POINTS) {
+        // draw straight from the slot
+        glBindVertexArray(r->VAO);
+        glVertexAttribIPointer(0, 1, GL_BYTE, sizeof(char), 0);
+        ring->shown = s;
+        r->generation = ring->stamps[s][0];
+    }
+    else if (ring->cells[s] >= 0) {
+        // draw the listed cells straight from the slot
+        glBindVertexArray(r->cellsVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, ring->buffers[s]);
+        glVertexAttribIPointer(0, 2, GL_INT, 2 * sizeof(int), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        ring->shown = s;
+        r->cells = ring->cells[s];
+        r->window.level = -1;
+    }
+    else {
+        // copy what changed (or the window) into the texture, the slot is free once the copy is done
+        if (ring->windows[s].level >= 0) {
+            renderer_uploadWindow(r, NULL, ring->windows[s]);
+        }
+        else {
+            renderer_uploadFrom(r, NULL, ring->stamps[s]);
+        }
+        ring->fences[s] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    glBindBuffer(ring->target, 0);
+
+    return true;
+}
+
+static void renderer_destroyRing(renderer* r) {
+    rendererRing* ring = &r->ring;
+
+    for (int s = 0; s < ring->slots; s++) {
+        if (ring->fences[s]) {
+            glDeleteSync(ring->fences[s]);
+        }
+        if (ring->mapped[s]) {
+            glBindBuffer(ring->target, ring->buffers[s]);
+            glUnmapBuffer(ring->target);
+        }
+        delete[] ring->stamps[s];
+    }
+    glBindBuffer(ring->target, 0);
+    glDeleteBuffers(ring->slots, ring->buffers);
+
+    delete[] ring->buffers;
+    delete[] ring->mapped;
+    delete[] ring->fences;
+    delete[] ring->stamps;
+    delete[] ring->windows;
+    delete[] ring->cells;
+    delete[] ring->boards;
+    delete[] ring->state;
+    ring->slots = 0;
+}
+
+int renderer_drawFrom(renderer* r, GLuint texture) {
+    if (r->mode != RENDERER_TEXTURE) {
+        return -1;
+    }
+
+    r->source = texture;
+    return 0;
+}
+
+void renderer_draw(renderer* r) {
+    glBindVertexArray(r->VAO);
+
+    // board column and row at the bottom left of the screen, as the shaders take x across
+    float originX = (float)r->view.y;
+    float originY = (float)r->view.x;
+    float cellsPerPixel = (float)(1.0 / r->view.scale);
+
+    if (r->mode == RENDERER_POINTS) {
+        glUseProgram(r->program);
+        glUniform2f(glGetUniformLocation(r->program, "origin"), originX, originY);
+        glUniform1f(glGetUniformLocation(r->program, "cellWidth"), 2.0f / (cellsPerPixel * r->width));
+        glUniform1f(glGetUniformLocation(r->program, "cellHeight"), 2.0f / (cellsPerPixel * r->height));
+        glDrawArrays(GL_POINTS, 0, r->x * r->y);
+        return;
+    }
+
+    if (r->cells >= 0 && r->window.level < 0) {
+        // a quad per listed cell
+        glBindVertexArray(r->cellsVAO);
+        glUseProgram(r->cellsProgram);
+        glUniform2f(glGetUniformLocation(r->cellsProgram, "origin"), originX, originY);
+        glUniform1f(glGetUniformLocation(r->cellsProgram, "cellWidth"), 2.0f / (cellsPerPixel * r->width));
+        glUniform1f(glGetUniformLocation(r->cellsProgram, "cellHeight"), 2.0f / (cellsPerPixel * r->height));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)r->cells);
+        return;
+    }
+
+    // a board texture from elsewhere, or whichever came last, the board or a window
+    bool window = !r->source && r->window.level >= 0;
+    GLuint program = window ? r->windowProgram : r->program;
+    glUseProgram(program);
+    glUniform2f(glGetUniformLocation(program, "origin"), originX, originY);
+    glUniform1f(glGetUniformLocation(program, "cellsPerPixel"), cellsPerPixel);
+    if (window) {
+        glUniform1i(glGetUniformLocation(program, "level"), r->window.level);
+        glUniform2i(glGetUniformLocation(program, "windowOrigin"), r->window.y, r->window.x);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, window ? r->windowTexture : r->source ? r->source : r->texture);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void renderer_destroy(renderer* r) {
+    if (r->ring.slots) {
+        renderer_destroyRing(r);
+    }
+
+    // clear buffers/arrays
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // delete buffers/arrays
+    if (r->VBO) {
+        glDeleteBuffers(1, &r->VBO);
+    }
+    if (r->texture) {
+        glDeleteTextures(1, &r->texture);
+    }
+    if (r->windowTexture) {
+        glDeleteTextures(1, &r->windowTexture);
+    }
+    glDeleteVertexArrays(1, &r->VAO);
+
+    // delete shaders
+    glDeleteProgram(r->program);
+    if (r->windowProgram) {
+        glDeleteProgram(r->windowProgram);
+    }
+    if (r->cellsProgram) {
+        glDeleteProgram(r->cellsProgram);
+        glDeleteVertexArrays(1, &r->cellsVAO);
+    }
+}
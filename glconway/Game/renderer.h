@@ -0,0 +1,166 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+
+#include "conway.h"
+
+/*
+    board rendering
+    - points: one vertex per cell, main.gs expands live cells to quads, cost grows with the board
+    - texture: the board is an integer texture sampled per pixel over one full-screen triangle,
+      cost grows with the window
+    - packed: as texture, but uploading 8 cells per byte (each row starting on a byte) and
+      decoding the bits in the shader
+    - instanced: while fewer than 1 in RENDERER_SPARSE cells live, the engine lists the live
+      cells and each is drawn as an instance of one quad, cost grows with the population;
+      denser boards are sent as in packed
+    - frames carry the board's change stamps when it tracks changes, and only the rectangles
+      changed since the frame last uploaded are sent
+    - with an upload ring, the simulation thread writes frames straight into mapped GPU buffers
+    - the view pans and zooms over the board; zoomed out past two cells a pixel (or for boards
+      too large for a texture) the texture modes are sent only the visible blocks of the
+      engine's density pyramid, so the cost follows the window rather than the board
+    - texture mode can instead draw a board texture kept elsewhere (as the GPU simulation's),
+      sampled a cell per pixel at every zoom
+*/
+typedef enum {
+    RENDERER_POINTS,
+    RENDERER_TEXTURE,
+    RENDERER_PACKED,
+    RENDERER_INSTANCED
+} rendererMode;
+
+#define RENDERER_SPARSE 64
+
+/*
+    upload ring
+    - slots GPU buffers (unpack buffers, or vertex buffers drawn from directly in points mode)
+    - persistently mapped when glBufferStorage is available, otherwise mapped unsynchronized
+      (invalidating) by the GL thread whenever a slot is free and unmapped before use
+    - a fence per slot tells when the GPU is done with it
+    - a slot keeps the board it was last written, so when the board tracks changes the writer only
+      copies the tiles changed since then, and the upload only sends those changed since the frame
+      on the GPU
+    - the writer never waits: with no free slot the frame is dropped (and remembered, so the writer
+      pushes its board again later), an unread frame is replaced
+*/
+#define RENDERER_SLOT_FREE 0    // mapped, nobody using it
+#define RENDERER_SLOT_WRITING 1 // being filled by the simulation thread
+#define RENDERER_SLOT_READY 2   // latest frame, not yet uploaded
+#define RENDERER_SLOT_GPU 3     // owned by the GL thread until its fence passes
+
+// board row at the bottom of the screen, column at its left, pixels per cell
+typedef struct {
+    double x;
+    double y;
+    double scale;
+} rendererView;
+
+// blocks [x, x + rows) x [y, y + cols) of a density level, level -1 for the whole board
+typedef struct {
+    int level;
+    int x;
+    int y;
+    int rows;
+    int cols;
+} rendererWindow;
+
+typedef struct {
+    int slots; // 0 without a ring
+    bool persistent;
+    GLenum target;
+    size_t size;
+
+    GLuint* buffers;
+    char** mapped;
+    GLsync* fences;
+    long long** stamps; // generation, tracked flag and tile stamps of each slot's frame
+    rendererWindow* windows; // what each slot holds
+    long long* cells;        // live cells listed in each slot, -1 if it holds a board or window
+    long long* boards;       // generation of the whole board each slot holds, -1 if it holds none
+    std::atomic<int>* state;
+
+    std::atomic<int> latest; // ready slot, -1 if none
+    std::atomic<bool> dropped; // the last frame pushed found no free slot
+    int shown;               // slot being drawn from (points, listed cells), -1 if none
+} rendererRing;
+
+typedef struct {
+    rendererMode mode;
+    int x;
+    int y;
+
+    GLuint program;
+    GLuint VAO;
+    GLuint VBO;     // points
+    GLuint texture; // texture, packed, 0 if the board does not fit in one
+    GLuint source;  // texture: board texture drawn instead, 0 for the uploaded board
+
+    GLuint windowProgram; // texture, packed: visible blocks of a density level
+    GLuint windowTexture;
+
+    GLuint cellsProgram; // instanced
+    GLuint cellsVAO;
+    long long cells; // live cells drawn instanced, -1 when drawing a texture
+
+    long long generation; // of the board on the GPU
+
+    rendererView view;
+    int width;  // framebuffer
+    int height;
+    rendererWindow window;  // drawn from, level -1 for the board
+    rendererWindow request; // for the next frame written, guarded by viewLock
+    std::mutex viewLock;
+
+    rendererRing ring;
+} renderer;
+
+// most rectangles uploaded for one frame before falling back to their bounds
+#define RENDERER_MAX_RECTS 64
+
+// shader program from files, geoShaderPath may be NULL
+int genShaderProgram(const char* vertexShaderPath,
+    const char* fragmentShaderPath,
+    const char* geoShaderPath);
+
+// returns -1 if the shaders could not be built
+int renderer_init(renderer* r, conway* c, rendererMode mode);
+
+// bytes in a frame for the mode (board, then generation and change stamps), and the frame for a board
+size_t renderer_frameSize(rendererMode mode, int x, int y);
+void renderer_writeFrame(rendererMode mode, conway* c, char* frame);
+
+// GL thread: pan and zoom, width and height being the framebuffer's
+void renderer_setView(renderer* r, rendererView view, int width, int height);
+// the whole board centered in the framebuffer
+rendererView renderer_fitView(renderer* r, int width, int height);
+
+// GL thread: set up the upload ring, load resolves glBufferStorage when the context has it
+void renderer_initRing(renderer* r, int slots, GLADloadproc load);
+
+// simulation thread: write the board (or the visible blocks) into a free slot, false if the frame was dropped
+bool renderer_ringPush(renderer* r, conway* c);
+
+// true if a frame is waiting for renderer_ringUpload
+bool renderer_ringPending(renderer* r);
+
+// simulation thread: true if the last frame was dropped, so the board should be pushed again
+bool renderer_ringDropped(renderer* r);
+
+// GL thread: recycle slots the GPU is done with and upload the latest frame, true if there was one
+bool renderer_ringUpload(renderer* r);
+
+// texture mode: draw an R8UI texture with a texel per cell (columns across, rows up) instead
+// of the uploaded board, 0 to go back, returns -1 in other modes
+int renderer_drawFrom(renderer* r, GLuint texture);
+
+// draw into the current framebuffer
+void renderer_draw(renderer* r);
+
+void renderer_destroy(renderer* r);
+
+#endif // RENDERER_H
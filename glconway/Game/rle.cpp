@@ -0,0 +1,327 @@
+#include "rle.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RLE_BUFFER 65536
+#define RLE_LINE 70
+
+/*
+    Reading
+*/
+
+typedef struct
+{
+    FILE *file;
+    char buf[RLE_BUFFER];
+    size_t len;
+    size_t pos;
+} rleReader;
+
+static int rle_getc(rleReader *r)
+{
+    if (r->pos == r->len)
+    {
+        r->len = fread(r->buf, 1, RLE_BUFFER, r->file);
+        r->pos = 0;
+        if (!r->len)
+        {
+            return EOF;
+        }
+    }
+
+    return (unsigned char)r->buf[r->pos++];
+}
+
+// read a line into line (truncated to size), returns its length or -1 at the end of the file
+static int rle_getLine(rleReader *r, char *line, int size)
+{
+    int len = 0;
+    int ch;
+    while ((ch = rle_getc(r)) != EOF && ch != '\n')
+    {
+        if (len < size - 1 && ch != '\r')
+        {
+            line[len++] = (char)ch;
+        }
+    }
+    line[len] = '\0';
+
+    return ch == EOF && !len ? -1 : len;
+}
+
+// skip comments and parse "x = m, y = n, rule = abc"
+static int rle_header(rleReader *r, int *width, int *height, char *rule, int ruleSize)
+{
+    char line[256];
+    int len;
+    while ((len = rle_getLine(r, line, sizeof(line))) >= 0)
+    {
+        if (!len || line[0] == '#')
+        {
+            continue;
+        }
+
+        *width = -1;
+        *height = -1;
+        rule[0] = '\0';
+
+        // "key = value" fields split by commas, except the rule, which runs to the end of the line
+        // (rules such as "B3/S23:T100,200" have commas of their own)
+        char *field = line;
+        while (*field)
+        {
+            char *key = field + strspn(field, " \t");
+            char *eq = strchr(key, '=');
+            if (!eq)
+            {
+                return -1;
+            }
+            char *value = eq + 1 + strspn(eq + 1, " \t");
+
+            if (!strncmp(key, "rule", 4))
+            {
+                strncpy(rule, value, ruleSize - 1);
+                rule[ruleSize - 1] = '\0';
+                size_t end = strlen(rule);
+                while (end && (rule[end - 1] == ' ' || rule[end - 1] == '\t'))
+                {
+                    end--;
+                }
+                rule[end] = '\0';
+                break;
+            }
+
+            if (*key == 'x')
+            {
+                *width = atoi(value);
+            }
+            else if (*key == 'y')
+            {
+                *height = atoi(value);
+            }
+
+            char *comma = strchr(value, ',');
+            field = comma ? comma + 1 : value + strlen(value);
+        }
+
+        return *width >= 0 && *height >= 0 ? 0 : -1;
+    }
+
+    return -1;
+}
+
+// decode the runs straight into the board
+static int rle_decode(rleReader *r, conway *c, long long x, long long y)
+{
+    long long row = 0;
+    long long col = 0;
+    long long count = 0;
+
+    int ch;
+    while ((ch = rle_getc(r)) != EOF)
+    {
+        if (ch >= '0' && ch <= '9')
+        {
+            count = count * 10 + (ch - '0');
+            continue;
+        }
+
+        long long n = count ? count : 1;
+        count = 0;
+
+        if (ch == '!')
+        {
+            return 0;
+        }
+        else if (ch == '$')
+        {
+            row += n;
+            col = 0;
+        }
+        else if (ch == 'b' || ch == '.')
+        {
+            col += n;
+        }
+        else if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'))
+        {
+            // live run (any other state counts as live), clipped to the board
+            long long bx = x + row;
+            long long by0 = y + col;
+            long long by1 = by0 + n;
+            if (bx >= 0 && bx < c->x)
+            {
+                by0 = by0 < 0 ? 0 : by0;
+                by1 = by1 > c->y ? c->y : by1;
+                if (by0 < by1)
+                {
+                    memset(c->board + bx * c->y + by0, 1, (size_t)(by1 - by0));
+                }
+            }
+            col += n;
+        }
+        else if (ch == '#')
+        {
+            // comment inside the body, skip the line
+            while ((ch = rle_getc(r)) != EOF && ch != '\n');
+        }
+    }
+
+    // missing terminator, keep what was read
+    return 0;
+}
+
+static rleReader *rle_open(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+
+    rleReader *r = (rleReader*)malloc(sizeof(rleReader));
+    r->file = file;
+    r->len = 0;
+    r->pos = 0;
+    return r;
+}
+
+static void rle_close(rleReader *r)
+{
+    fclose(r->file);
+    free(r);
+}
+
+int rle_load(conway *c, const char *path, char wrap)
+{
+    rleReader *r = rle_open(path);
+    if (!r)
+    {
+        return -1;
+    }
+
+    int width, height;
+    char rule[64];
+    if (rle_header(r, &width, &height, rule, sizeof(rule)))
+    {
+        rle_close(r);
+        return -1;
+    }
+
+    conway_init(c, wrap, height, width);
+    if (rule[0] && conway_setRule(c, rule))
+    {
+        conway_destroy(c);
+        rle_close(r);
+        return -1;
+    }
+
+    int ret = rle_decode(r, c, 0, 0);
+    rle_close(r);
+    return ret;
+}
+
+int rle_paste(conway *c, const char *path, int x, int y)
+{
+    rleReader *r = rle_open(path);
+    if (!r)
+    {
+        return -1;
+    }
+
+    int width, height;
+    char rule[64];
+    int ret = rle_header(r, &width, &height, rule, sizeof(rule));
+    if (!ret)
+    {
+        ret = rle_decode(r, c, x, y);
+        conwayRect written = { x, y, height, width };
+        conway_markChanged(c, written);
+    }
+
+    rle_close(r);
+    return ret;
+}
+
+/*
+    Writing
+*/
+
+typedef struct
+{
+    FILE *file;
+    int lineLen;
+
+    // rows ended but not yet written, so trailing empty rows cost nothing
+    long long pendingRows;
+} rleWriter;
+
+static void rle_emit(rleWriter *w, long long count, char tag)
+{
+    char token[32];
+    int len = count > 1
+        ? snprintf(token, sizeof(token), "%lld%c", count, tag)
+        : snprintf(token, sizeof(token), "%c", tag);
+
+    // keep lines short
+    if (w->lineLen + len > RLE_LINE)
+    {
+        fputc('\n', w->file);
+        w->lineLen = 0;
+    }
+
+    fwrite(token, 1, len, w->file);
+    w->lineLen += len;
+}
+
+int rle_save(conway *c, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, RLE_BUFFER);
+
+    char rule[32];
+    conway_ruleString(c, rule);
+    fprintf(file, "x = %d, y = %d, rule = %s\n", c->y, c->x, rule);
+
+    rleWriter w = { file, 0, 0 };
+    for (int x = 0; x < c->x; x++)
+    {
+        const char *row = c->board + (size_t)x * c->y;
+        const char *end = row + c->y;
+        const char *p = row;
+
+        while (p < end)
+        {
+            // dead run up to the next live cell, dropped at the end of the row
+            const char *live = (const char*)memchr(p, 1, end - p);
+            if (!live)
+            {
+                break;
+            }
+
+            if (w.pendingRows)
+            {
+                rle_emit(&w, w.pendingRows, '$');
+                w.pendingRows = 0;
+            }
+            if (live > p)
+            {
+                rle_emit(&w, live - p, 'b');
+            }
+
+            // live run
+            const char *dead = (const char*)memchr(live, 0, end - live);
+            p = dead ? dead : end;
+            rle_emit(&w, p - live, 'o');
+        }
+
+        w.pendingRows++;
+    }
+
+    fputs("!\n", file);
+    return fclose(file) ? -1 : 0;
+}
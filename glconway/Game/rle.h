@@ -0,0 +1,25 @@
+#ifndef RLE_H
+#define RLE_H
+
+#include <stdio.h>
+
+#include "conway.h"
+
+/*
+    run length encoded (.rle) patterns
+    - RLE x (width) maps to board columns (c->y), RLE y (height) to rows (c->x)
+    - files are streamed through a fixed size buffer, never loaded whole
+    - functions return 0 on success, -1 on error
+*/
+
+// initialize c to the size and rule in the header and decode the pattern into it
+int rle_load(conway *c, const char *path, char wrap);
+
+// decode the pattern into an existing board with its top left cell at row x, column y
+// live cells are added, anything falling off the board is dropped
+int rle_paste(conway *c, const char *path, int x, int y);
+
+// encode the board run by run
+int rle_save(conway *c, const char *path);
+
+#endif // RLE_H
@@ -0,0 +1,237 @@
+#include "terminal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// braille dot bit for each cell of a 4 row by 2 column glyph
+static const unsigned char terminal_brailleBits[4][2] = {
+    { 0x01, 0x08 },
+    { 0x02, 0x10 },
+    { 0x04, 0x20 },
+    { 0x40, 0x80 }
+};
+
+// longest escape plus glyph emitted per position
+#define TERMINAL_MAX_GLYPH 32
+
+static int terminal_write(const char *data, size_t size)
+{
+    // anything buffered in stdio goes first
+    fflush(stdout);
+
+#ifdef _WIN32
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    while (size)
+    {
+        DWORD written = 0;
+        if (!WriteFile(out, data, (DWORD)size, &written, NULL))
+        {
+            return -1;
+        }
+        data += written;
+        size -= written;
+    }
+#else
+    while (size)
+    {
+        ssize_t written = write(STDOUT_FILENO, data, size);
+        if (written < 0)
+        {
+            return -1;
+        }
+        data += written;
+        size -= written;
+    }
+#endif
+
+    return 0;
+}
+
+void terminal_init(terminal *t, int x, int y, terminalGlyphs glyphs, double maxFps)
+{
+    t->glyphs = glyphs;
+    t->cellRows = glyphs == TERMINAL_BRAILLE ? 4 : 2;
+    t->cellCols = glyphs == TERMINAL_BRAILLE ? 2 : 1;
+
+    t->x = x;
+    t->y = y;
+    t->rows = (x + t->cellRows - 1) / t->cellRows;
+    t->cols = (y + t->cellCols - 1) / t->cellCols;
+
+    size_t n = (size_t)t->rows * t->cols;
+    t->previous = (unsigned char*)malloc(n);
+    t->current = (unsigned char*)malloc(n);
+    t->drawn = false;
+
+    // every glyph, a status line and the screen setup
+    t->outSize = n * TERMINAL_MAX_GLYPH + 128;
+    t->out = (char*)malloc(t->outSize);
+
+    t->minInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(maxFps > 0 ? 1.0 / maxFps : 0.0));
+    t->last = std::chrono::steady_clock::now() - t->minInterval;
+
+#ifdef _WIN32
+    // UTF-8 output with escape sequences
+    SetConsoleOutputCP(CP_UTF8);
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (GetConsoleMode(out, &mode))
+    {
+        SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+}
+
+static void terminal_pack(terminal *t, conway *c)
+{
+    memset(t->current, 0, (size_t)t->rows * t->cols);
+
+    for (int x = 0; x < c->x; x++)
+    {
+        const char *row = c->board + (size_t)x * c->y;
+        unsigned char *glyphs = t->current + (size_t)(x / t->cellRows) * t->cols;
+
+        if (t->glyphs == TERMINAL_BRAILLE)
+        {
+            const unsigned char *bits = terminal_brailleBits[x & 3];
+            for (int y = 0; y < c->y; y++)
+            {
+                glyphs[y >> 1] |= row[y] ? bits[y & 1] : 0;
+            }
+        }
+        else
+        {
+            // bit 0 for the upper half, bit 1 for the lower
+            unsigned char bit = 1 << (x & 1);
+            for (int y = 0; y < c->y; y++)
+            {
+                glyphs[y] |= row[y] ? bit : 0;
+            }
+        }
+    }
+}
+
+static char *terminal_glyph(terminal *t, unsigned char bits, char *out)
+{
+    if (!bits)
+    {
+        *out++ = ' ';
+    }
+    else if (t->glyphs == TERMINAL_BRAILLE)
+    {
+        // U+2800 + dots
+        *out++ = (char)0xE2;
+        *out++ = (char)(0xA0 | (bits >> 6));
+        *out++ = (char)(0x80 | (bits & 0x3F));
+    }
+    else
+    {
+        // U+2580 upper half, U+2584 lower half, U+2588 full block
+        static const unsigned char last[4] = { 0, 0x80, 0x84, 0x88 };
+        *out++ = (char)0xE2;
+        *out++ = (char)0x96;
+        *out++ = (char)last[bits];
+    }
+
+    return out;
+}
+
+bool terminal_due(terminal *t)
+{
+    return std::chrono::steady_clock::now() - t->last >= t->minInterval;
+}
+
+int terminal_render(terminal *t, conway *c)
+{
+    if (c->x != t->x || c->y != t->y)
+    {
+        return -1;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - t->last < t->minInterval)
+    {
+        return 0;
+    }
+    t->last = now;
+
+    terminal_pack(t, c);
+
+    char *out = t->out;
+    if (!t->drawn)
+    {
+        // hide cursor, clear screen
+        out += sprintf(out, "\x1b[?25l\x1b[2J");
+    }
+
+    for (int r = 0; r < t->rows; r++)
+    {
+        const unsigned char *current = t->current + (size_t)r * t->cols;
+        const unsigned char *previous = t->previous + (size_t)r * t->cols;
+
+        // column the cursor is at on this row, -1 if elsewhere
+        int cursor = -1;
+        for (int col = 0; col < t->cols; col++)
+        {
+            if (t->drawn && current[col] == previous[col])
+            {
+                continue;
+            }
+
+            if (cursor >= 0 && col - cursor <= 3)
+            {
+                // rewriting a short gap is cheaper than moving over it
+                while (cursor < col)
+                {
+                    out = terminal_glyph(t, current[cursor++], out);
+                }
+            }
+            else
+            {
+                out += sprintf(out, "\x1b[%d;%dH", r + 1, col + 1);
+            }
+
+            out = terminal_glyph(t, current[col], out);
+            cursor = col + 1;
+        }
+    }
+
+    // status line below the board
+    out += sprintf(out, "\x1b[%d;1Hgeneration %lld\x1b[K\n", t->rows + 1, c->generation);
+
+    unsigned char *swap = t->previous;
+    t->previous = t->current;
+    t->current = swap;
+    t->drawn = true;
+
+    return terminal_write(t->out, out - t->out) ? -1 : 1;
+}
+
+void terminal_invalidate(terminal *t)
+{
+    t->drawn = false;
+}
+
+void terminal_destroy(terminal *t)
+{
+    if (t->drawn)
+    {
+        // show cursor again
+        terminal_write("\x1b[?25h", 6);
+    }
+
+    free(t->previous);
+    free(t->current);
+    free(t->out);
+    t->previous = NULL;
+    t->current = NULL;
+    t->out = NULL;
+}
@@ -0,0 +1,58 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include <chrono>
+#include <stddef.h>
+
+#include "conway.h"
+
+/*
+    ANSI terminal renderer
+    - cells are packed into glyphs: 2x4 per braille character or 1x2 per half block
+    - only glyphs that changed since the last drawn frame are emitted, each behind a cursor move
+    - a frame is built in one buffer and written with a single call
+    - frames arriving faster than maxFps are skipped, the next drawn frame catches up
+*/
+typedef enum
+{
+    TERMINAL_BRAILLE,
+    TERMINAL_HALFBLOCK
+} terminalGlyphs;
+
+typedef struct
+{
+    terminalGlyphs glyphs;
+    int cellRows; // cells per glyph
+    int cellCols;
+
+    int x; // board dimensions
+    int y;
+    int rows; // glyph grid dimensions
+    int cols;
+
+    // glyph bits per position, last drawn and being built
+    unsigned char *previous;
+    unsigned char *current;
+    bool drawn; // previous is on screen
+
+    char *out;
+    size_t outSize;
+
+    std::chrono::steady_clock::duration minInterval;
+    std::chrono::steady_clock::time_point last;
+} terminal;
+
+void terminal_init(terminal *t, int x, int y, terminalGlyphs glyphs, double maxFps);
+
+// returns 1 if the frame was drawn, 0 if skipped by the rate limit, -1 on write failure
+int terminal_render(terminal *t, conway *c);
+
+// whether the rate limit would let a frame through now
+bool terminal_due(terminal *t);
+
+// redraw everything on the next frame
+void terminal_invalidate(terminal *t);
+
+void terminal_destroy(terminal *t);
+
+#endif // TERMINAL_H
@@ -0,0 +1,22 @@
+#version 330 core
+
+// one texel per cell, columns along x and rows along y
+uniform usampler2D board;
+
+// board column and row at the bottom left of the screen, cells across a pixel
+uniform vec2 origin;
+uniform float cellsPerPixel;
+
+out vec4 color;
+
+void main() {
+	ivec2 size = textureSize(board, 0);
+	ivec2 cell = ivec2(floor(origin + gl_FragCoord.xy * cellsPerPixel));
+	if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, size))) {
+		color = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	uint alive = texelFetch(board, cell, 0).r;
+	color = vec4(vec3(alive != 0u ? 1.0 : 0.0), 1.0);
+}
@@ -0,0 +1,7 @@
+#version 330 core
+
+void main() {
+	// one triangle covering the screen, from the vertex index alone, fragment shaders work from gl_FragCoord
+	vec2 pos = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+	gl_Position = vec4(pos, 0.0, 1.0);
+}
@@ -0,0 +1,164 @@
+#include "threadPool.h"
+
+#include <chrono>
+
+// worker index of the current thread, -1 outside any pool
+static thread_local threadPool *currentPool = NULL;
+static thread_local int currentWorker = -1;
+
+int threadPool_index(threadPool *pool)
+{
+    return currentPool == pool ? currentWorker : pool->nThreads - 1;
+}
+
+// pop from our own queue, otherwise steal from someone else's
+static bool threadPool_take(threadPool *pool, threadPoolTask &task)
+{
+    int self = threadPool_index(pool);
+
+    {
+        threadPoolQueue *q = pool->queues + self;
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (!q->tasks.empty())
+        {
+            task = std::move(q->tasks.back());
+            q->tasks.pop_back();
+            pool->queued--;
+            return true;
+        }
+    }
+
+    for (int i = 1; i < pool->nThreads; i++)
+    {
+        threadPoolQueue *q = pool->queues + (self + i) % pool->nThreads;
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (!q->tasks.empty())
+        {
+            task = std::move(q->tasks.front());
+            q->tasks.pop_front();
+            pool->queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void threadPool_worker(threadPool *pool, int index)
+{
+    currentPool = pool;
+    currentWorker = index;
+
+    threadPoolTask task;
+    while (pool->running.load())
+    {
+        if (threadPool_take(pool, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        // nothing to do, sleep until work is spawned
+        std::unique_lock<std::mutex> guard(pool->sleepLock);
+        pool->wake.wait_for(guard, std::chrono::milliseconds(1), [pool] {
+            return pool->queued.load() > 0 || !pool->running.load();
+        });
+    }
+}
+
+void threadPool_init(threadPool *pool, int nThreads)
+{
+    if (nThreads <= 0)
+    {
+        nThreads = (int)std::thread::hardware_concurrency();
+        if (nThreads <= 0)
+        {
+            nThreads = 1;
+        }
+    }
+
+    pool->nThreads = nThreads;
+    pool->queues = new threadPoolQueue[nThreads];
+    pool->queued.store(0);
+    pool->running.store(true);
+
+    // the calling thread helps while waiting, so it counts as one of the threads
+    for (int i = 0; i < nThreads - 1; i++)
+    {
+        pool->workers.emplace_back(threadPool_worker, pool, i);
+    }
+}
+
+void threadPool_spawn(threadPool *pool, threadPoolGroup *group, threadPoolTask task)
+{
+    group->pending++;
+
+    threadPoolQueue *q = pool->queues + threadPool_index(pool);
+    {
+        std::lock_guard<std::mutex> guard(q->lock);
+        q->tasks.push_back([group, task = std::move(task)] {
+            task();
+            group->pending--;
+        });
+    }
+
+    pool->queued++;
+    pool->wake.notify_one();
+}
+
+void threadPool_wait(threadPool *pool, threadPoolGroup *group)
+{
+    threadPoolTask task;
+    while (group->pending.load() > 0)
+    {
+        // help out instead of blocking
+        if (threadPool_take(pool, task))
+        {
+            task();
+            task = nullptr;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void threadPool_parallelFor(threadPool *pool, long long n, long long grain,
+    const std::function<void(long long, long long)> &fn)
+{
+    if (grain < 1)
+    {
+        grain = 1;
+    }
+
+    threadPoolGroup group;
+    group.pending.store(0);
+
+    for (long long begin = 0; begin < n; begin += grain)
+    {
+        long long end = begin + grain < n ? begin + grain : n;
+        threadPool_spawn(pool, &group, [&fn, begin, end] {
+            fn(begin, end);
+        });
+    }
+
+    threadPool_wait(pool, &group);
+}
+
+void threadPool_destroy(threadPool *pool)
+{
+    pool->running.store(false);
+    pool->wake.notify_all();
+
+    for (std::thread &worker : pool->workers)
+    {
+        worker.join();
+    }
+    pool->workers.clear();
+
+    delete[] pool->queues;
+    pool->queues = NULL;
+    pool->nThreads = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> threadPoolTask;
+
+/*
+    work-stealing thread pool
+    - each worker pushes and pops its own deque from the back
+    - idle workers steal from the front of the others' deques
+    - threads waiting on a group run pending tasks instead of blocking
+*/
+typedef struct
+{
+    std::mutex lock;
+    std::deque<threadPoolTask> tasks;
+} threadPoolQueue;
+
+typedef struct
+{
+    int nThreads;
+    std::vector<std::thread> workers;
+
+    // one queue per thread, the last one for threads outside the pool
+    threadPoolQueue *queues;
+
+    std::atomic<int> queued;
+    std::atomic<bool> running;
+
+    std::mutex sleepLock;
+    std::condition_variable wake;
+} threadPool;
+
+// set of tasks that can be waited on together
+typedef struct
+{
+    std::atomic<int> pending;
+} threadPoolGroup;
+
+void threadPool_init(threadPool *pool, int nThreads);
+
+// index in [0, nThreads) of the current thread, nThreads - 1 for threads outside the pool
+int threadPool_index(threadPool *pool);
+
+void threadPool_spawn(threadPool *pool, threadPoolGroup *group, threadPoolTask task);
+void threadPool_wait(threadPool *pool, threadPoolGroup *group);
+
+// run fn(begin, end) over [0, n) in chunks of at most grain, then wait
+void threadPool_parallelFor(threadPool *pool, long long n, long long grain,
+    const std::function<void(long long, long long)> &fn);
+
+void threadPool_destroy(threadPool *pool);
+
+#endif // THREADPOOL_H
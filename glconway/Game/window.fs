@@ -0,0 +1,25 @@
+#version 330 core
+
+// blocks of 2^level cells from windowOrigin on, the share of each block alive
+uniform sampler2D window;
+uniform ivec2 windowOrigin;
+uniform int level;
+uniform ivec2 board;
+
+// board column and row at the bottom left of the screen, cells across a pixel
+uniform vec2 origin;
+uniform float cellsPerPixel;
+
+out vec4 color;
+
+void main() {
+	ivec2 cell = ivec2(floor(origin + gl_FragCoord.xy * cellsPerPixel));
+	ivec2 block = (cell >> level) - windowOrigin;
+	if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, board)) ||
+		any(lessThan(block, ivec2(0))) || any(greaterThanEqual(block, textureSize(window, 0)))) {
+		color = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	color = vec4(vec3(texelFetch(window, block, 0).r), 1.0);
+}